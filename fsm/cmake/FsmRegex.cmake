@@ -0,0 +1,22 @@
+################################################################################
+# fsm_generate_regex(<name> <pattern> <output>)
+#
+# Generates the header <output> with the matcher fsm::generated::<name> for
+# <pattern>, compiled into a static DFA table at build time. Add <output> to
+# the sources of a target and include it to use the matcher. Requires the
+# fsmgen tool (BUILD_FSM_GEN).
+################################################################################
+
+function(fsm_generate_regex NAME PATTERN OUTPUT)
+    if(NOT TARGET ${FSM_GEN})
+        message(FATAL_ERROR "fsm_generate_regex requires BUILD_FSM_GEN")
+    endif()
+
+    add_custom_command(
+        OUTPUT ${OUTPUT}
+        COMMAND ${FSM_GEN} ${NAME} ${PATTERN} ${OUTPUT}
+        DEPENDS ${FSM_GEN}
+        COMMENT "Generating regex matcher ${NAME}"
+        VERBATIM
+        )
+endfunction()
@@ -0,0 +1,199 @@
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "fsm/Dfa.hpp"
+#include "fsm/Fsm.hpp"
+#include "fsm/Regex.hpp"
+
+namespace {
+
+const std::size_t c_values_per_line = 16;
+
+void printUsage()
+{
+    std::cerr << "usage: fsmgen name pattern output" << std::endl;
+}
+
+bool isIdentifier(const std::string &name)
+{
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])))
+    {
+        return false;
+    }
+
+    for (char c : name)
+    {
+        if (c != '_' && !std::isalnum(static_cast<unsigned char>(c)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// Escapes the pattern for a line comment.
+std::string escape(const std::string &pattern)
+{
+    std::ostringstream stream;
+
+    for (char c : pattern)
+    {
+        auto byte = static_cast<unsigned char>(c);
+
+        if (std::isprint(byte))
+        {
+            stream << c;
+        }
+        else
+        {
+            stream << "\\x" << std::hex << (byte >> 4) << (byte & 0xf)
+                   << std::dec;
+        }
+    }
+
+    return stream.str();
+}
+
+/// Smallest unsigned type that holds every state id of the table.
+std::string stateType(const fsm::Dfa &dfa)
+{
+    const std::size_t max_state = dfa.getTable().size();
+
+    if (max_state <= std::numeric_limits<std::uint8_t>::max())
+    {
+        return "std::uint8_t";
+    }
+
+    if (max_state <= std::numeric_limits<std::uint16_t>::max())
+    {
+        return "std::uint16_t";
+    }
+
+    return "std::uint32_t";
+}
+
+template <class T>
+void printArray(
+    std::ostream &stream,
+    const std::string &type,
+    const std::string &name,
+    const std::vector<T> &values)
+{
+    stream << "        static const " << type << " " << name << "["
+           << values.size() << "] = {";
+
+    for (std::size_t i = 0; i < values.size(); i++)
+    {
+        stream << (i % c_values_per_line ? " " : "\n            ")
+               << static_cast<std::uint64_t>(values[i]) << ",";
+    }
+
+    stream << "\n        };\n";
+}
+
+/// Writes a header with a matcher that runs the minimal DFA of the pattern
+/// over tables baked into the header, so nothing is compiled at run time.
+void generate(
+    std::ostream &stream,
+    const std::string &name,
+    const std::string &pattern)
+{
+    const fsm::Dfa dfa(fsm::Regex::buildFsm(pattern).min());
+    const fsm::ByteClasses &byte_classes = dfa.getByteClasses();
+    const std::string state_t = stateType(dfa);
+
+    std::vector<unsigned> classes(fsm::ByteClasses::byte_count);
+
+    for (std::size_t b = 0; b < classes.size(); b++)
+    {
+        classes[b] = byte_classes[static_cast<unsigned char>(b)];
+    }
+
+    std::vector<unsigned> finals(dfa.getStateCount());
+
+    for (std::size_t i = 0; i < finals.size(); i++)
+    {
+        finals[i] = dfa.isFinal(
+            static_cast<fsm::Dfa::state_t>(i * dfa.getClassCount()));
+    }
+
+    stream << "// Generated by fsmgen from the pattern \"" << escape(pattern)
+           << "\". Do not edit.\n\n"
+           << "#pragma once\n\n"
+           << "#include <cstddef>\n"
+           << "#include <cstdint>\n"
+           << "#include <string>\n\n"
+           << "namespace fsm {\n"
+           << "namespace generated {\n\n"
+           << "struct " << name << " final\n"
+           << "{\n"
+           << "    static bool match(const char *data, std::size_t size)\n"
+           << "    {\n";
+
+    printArray(stream, "std::uint8_t", "classes", classes);
+    printArray(stream, state_t, "table", dfa.getTable());
+    printArray(stream, "bool", "finals", finals);
+
+    stream << "\n"
+           << "        const unsigned char *p =\n"
+           << "            reinterpret_cast<const unsigned char *>(data);\n"
+           << "        " << state_t << " state = " << dfa.getStartingState()
+           << ";\n\n"
+           << "        for (std::size_t i = 0; i < size; i++)\n"
+           << "        {\n"
+           << "            state = table[state + classes[p[i]]];\n\n"
+           << "            if (state == " << fsm::Dfa::dead_state << ")\n"
+           << "            {\n"
+           << "                return false;\n"
+           << "            }\n"
+           << "        }\n\n"
+           << "        return finals[state / " << dfa.getClassCount()
+           << "];\n"
+           << "    }\n\n"
+           << "    static bool match(const std::string &str)\n"
+           << "    {\n"
+           << "        return match(str.data(), str.size());\n"
+           << "    }\n"
+           << "};\n\n"
+           << "} // namespace generated\n"
+           << "} // namespace fsm\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc != 4 || !isIdentifier(argv[1]))
+    {
+        printUsage();
+        return 2;
+    }
+
+    try
+    {
+        std::ostringstream header;
+        generate(header, argv[1], argv[2]);
+
+        std::ofstream file(argv[3]);
+
+        if (!file || !(file << header.str()))
+        {
+            throw std::runtime_error(
+                "cannot write " + std::string(argv[3]));
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "fsmgen: " << e.what() << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
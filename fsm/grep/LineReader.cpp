@@ -0,0 +1,78 @@
+#include "LineReader.hpp"
+#include <cerrno>
+#include <stdexcept>
+#include <poll.h>
+#include <unistd.h>
+
+namespace fsmgrep {
+
+LineReader::LineReader(int fd, std::size_t block_size)
+    : m_fd{fd}
+    , m_block_size{block_size}
+    , m_size{0}
+    , m_eof{false}
+{
+}
+
+bool LineReader::next()
+{
+    m_buffer.erase(0, m_size);
+    m_size = 0;
+
+    while (true)
+    {
+        if (!m_buffer.empty() &&
+            (m_eof || m_buffer.size() >= m_block_size || !isReady()))
+        {
+            std::size_t eol = m_buffer.rfind('\n');
+
+            if (eol != std::string::npos)
+            {
+                m_size = eol + 1;
+                return true;
+            }
+
+            if (m_eof)
+            {
+                m_size = m_buffer.size();
+                return true;
+            }
+        }
+
+        if (m_eof)
+        {
+            return false;
+        }
+
+        const std::size_t old_size = m_buffer.size();
+        m_buffer.resize(old_size + m_block_size);
+
+        ssize_t n = read(m_fd, &m_buffer[old_size], m_block_size);
+
+        if (n < 0 && errno != EINTR)
+        {
+            throw std::runtime_error("couldn't read input");
+        }
+
+        m_buffer.resize(old_size + (n > 0 ? n : 0));
+        m_eof = n == 0;
+    }
+}
+
+const char *LineReader::data() const
+{
+    return m_buffer.data();
+}
+
+std::size_t LineReader::size() const
+{
+    return m_size;
+}
+
+bool LineReader::isReady() const
+{
+    pollfd fd{m_fd, POLLIN, 0};
+    return poll(&fd, 1, 0) > 0;
+}
+
+} // namespace fsmgrep
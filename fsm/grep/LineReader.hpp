@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace fsmgrep {
+
+/// Reads a file descriptor in blocks of whole lines.
+///
+/// A block is handed out once it holds at least the requested number of
+/// bytes or no more input is ready, so lines written to a pipe come out
+/// while the writer is still going. Only the last line of the input may
+/// lack its terminator.
+class LineReader final
+{
+public: // methods
+    LineReader(int fd, std::size_t block_size);
+
+    LineReader(const LineReader &) = delete;
+    LineReader &operator=(const LineReader &) = delete;
+
+    /// Reads the next block, returning false at the end of the input.
+    bool next();
+
+    const char *data() const;
+    std::size_t size() const;
+
+private: // methods
+    bool isReady() const;
+
+private: // fields
+    int m_fd;
+    std::size_t m_block_size;
+    std::string m_buffer;
+    std::size_t m_size;
+    bool m_eof;
+};
+
+} // namespace fsmgrep
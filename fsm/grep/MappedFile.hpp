@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace fsmgrep {
+
+/// Read-only memory mapping of a whole file.
+class MappedFile final
+{
+public: // methods
+    explicit MappedFile(const std::string &file_name);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const;
+    std::size_t size() const;
+
+private: // fields
+    const char *m_data;
+    std::size_t m_size;
+};
+
+} // namespace fsmgrep
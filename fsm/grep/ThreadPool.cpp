@@ -0,0 +1,138 @@
+#include "ThreadPool.hpp"
+#include <utility>
+
+namespace fsmgrep {
+
+ThreadPool::ThreadPool(std::size_t threads)
+    : m_queued{0}
+    , m_pending{0}
+    , m_next_queue{0}
+    , m_stop{false}
+{
+    if (threads == 0)
+    {
+        threads = 1;
+    }
+
+    for (std::size_t i = 0; i < threads; i++)
+    {
+        m_queues.emplace_back(new Queue);
+    }
+
+    for (std::size_t i = 0; i < threads; i++)
+    {
+        m_threads.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_task_available.notify_all();
+
+    for (std::thread &thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+std::size_t ThreadPool::size() const
+{
+    return m_threads.size();
+}
+
+void ThreadPool::submit(Task task)
+{
+    std::size_t index;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        index = m_next_queue++ % m_queues.size();
+        m_queued++;
+        m_pending++;
+    }
+
+    {
+        Queue &queue = *m_queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    m_task_available.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_tasks_done.wait(lock, [&]() { return m_pending == 0; });
+}
+
+void ThreadPool::work(std::size_t index)
+{
+    Task task;
+
+    while (true)
+    {
+        if (pop(index, task))
+        {
+            task();
+            task = nullptr;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (--m_pending == 0)
+            {
+                m_tasks_done.notify_all();
+            }
+
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_task_available.wait(
+            lock, [&]() { return m_stop || m_queued > 0; });
+
+        if (m_stop && m_queued == 0)
+        {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::pop(std::size_t index, Task &task)
+{
+    for (std::size_t i = 0; i < m_queues.size(); i++)
+    {
+        Queue &queue = *m_queues[(index + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tasks.empty())
+        {
+            continue;
+        }
+
+        if (i == 0)
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+
+        std::lock_guard<std::mutex> counter_lock(m_mutex);
+        m_queued--;
+
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace fsmgrep
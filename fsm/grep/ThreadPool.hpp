@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fsmgrep {
+
+/// Fixed set of workers with one task deque each.
+///
+/// Submitted tasks are spread over the deques round-robin. A worker takes
+/// tasks from the back of its own deque and, once that is empty, steals from
+/// the front of the others.
+class ThreadPool final
+{
+public: // types
+    using Task = std::function<void()>;
+
+public: // methods
+    explicit ThreadPool(std::size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    std::size_t size() const;
+
+    void submit(Task task);
+    void wait();
+
+private: // types
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+private: // methods
+    void work(std::size_t index);
+    bool pop(std::size_t index, Task &task);
+
+private: // fields
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_task_available;
+    std::condition_variable m_tasks_done;
+
+    std::size_t m_queued;
+    std::size_t m_pending;
+    std::size_t m_next_queue;
+    bool m_stop;
+};
+
+} // namespace fsmgrep
@@ -0,0 +1,363 @@
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "LineReader.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+#include "fsm/Dfa.hpp"
+#include "fsm/Fsm.hpp"
+#include "fsm/LiteralFinder.hpp"
+#include "fsm/Regex.hpp"
+
+namespace {
+
+const std::size_t c_chunk_size = 1 << 20;
+
+struct Options
+{
+    bool count = false;
+    bool invert = false;
+    bool whole_line = false;
+    std::size_t threads = std::thread::hardware_concurrency();
+    std::string pattern;
+    std::vector<std::string> files;
+};
+
+struct Chunk
+{
+    const char *begin;
+    const char *end;
+    std::size_t count;
+    std::string output;
+};
+
+void printUsage()
+{
+    std::cerr << "usage: fsmgrep [-c] [-v] [-x] [-j threads] pattern [file...]"
+              << std::endl;
+}
+
+bool parseOptions(int argc, char **argv, Options &options)
+{
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-' && argv[i][1]; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--")
+        {
+            i++;
+            break;
+        }
+        else if (arg == "-c")
+        {
+            options.count = true;
+        }
+        else if (arg == "-v")
+        {
+            options.invert = true;
+        }
+        else if (arg == "-x")
+        {
+            options.whole_line = true;
+        }
+        else if (arg == "-j" && i + 1 < argc)
+        {
+            options.threads = std::stoul(argv[++i]);
+        }
+        else if (arg.compare(0, 2, "-j") == 0)
+        {
+            options.threads = std::stoul(arg.substr(2));
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if (i >= argc)
+    {
+        return false;
+    }
+
+    options.pattern = argv[i++];
+    options.files.assign(argv + i, argv + argc);
+
+    return true;
+}
+
+/// Matches lines containing the pattern: the pattern automaton surrounded by
+/// loops over every byte except the line terminator. Stores the literal that
+/// every match contains in @p literal.
+fsm::Fsm buildSearchFsm(const std::string &pattern, std::string &literal)
+{
+    fsm::Fsm pattern_fsm = fsm::Regex::buildFsm(pattern, literal);
+    const auto &transitions = pattern_fsm.getTransitions();
+
+    const fsm::Fsm::state_t start = transitions.size();
+    const fsm::Fsm::state_t end = start + 1;
+
+    fsm::Fsm fsm(transitions.size() + 2, {start}, {end});
+
+    for (fsm::Fsm::state_t s = 0; s < transitions.size(); s++)
+    {
+        for (const fsm::Fsm::Transition &tr : transitions[s])
+        {
+            fsm.connect(s, tr.state, tr.first, tr.last);
+        }
+    }
+
+    for (fsm::Fsm::state_t s : {start, end})
+    {
+        fsm.connect(s, s, '\x01', '\x09');
+        fsm.connect(s, s, '\x0b', '\xff');
+    }
+
+    for (fsm::Fsm::state_t s : pattern_fsm.getStartingStates())
+    {
+        fsm.connect(start, s, '\0');
+    }
+
+    for (fsm::Fsm::state_t s : pattern_fsm.getFinalStates())
+    {
+        fsm.connect(s, end, '\0');
+    }
+
+    return fsm;
+}
+
+/// Only lines containing the required literal of the pattern are run through
+/// the automaton. Without -v, the lines before the next occurrence of the
+/// literal are skipped altogether.
+void processChunk(
+    const fsm::Dfa &dfa,
+    const fsm::LiteralFinder &prefilter,
+    const Options &options,
+    Chunk &chunk)
+{
+    const char *line = chunk.begin;
+    const char *candidate = prefilter.find(chunk.begin, chunk.end);
+
+    while (line < chunk.end)
+    {
+        if (candidate && candidate < line)
+        {
+            candidate = prefilter.find(line, chunk.end);
+        }
+
+        if (!options.invert)
+        {
+            if (!candidate)
+            {
+                break;
+            }
+
+            line = candidate;
+
+            while (line > chunk.begin && line[-1] != '\n')
+            {
+                line--;
+            }
+        }
+
+        const char *eol = static_cast<const char *>(
+            std::memchr(line, '\n', chunk.end - line));
+        const char *next = eol ? eol + 1 : chunk.end;
+
+        if (!eol)
+        {
+            eol = chunk.end;
+        }
+
+        bool matched =
+            candidate && candidate < eol && dfa.match(line, eol - line);
+
+        if (matched != options.invert)
+        {
+            chunk.count++;
+
+            if (!options.count)
+            {
+                chunk.output.append(line, eol);
+                chunk.output += '\n';
+            }
+        }
+
+        line = next;
+    }
+}
+
+std::vector<Chunk> splitLines(const char *data, std::size_t size)
+{
+    std::vector<Chunk> chunks;
+
+    const char *begin = data;
+    const char *end = data + size;
+
+    while (begin < end)
+    {
+        const char *split = end;
+
+        if (static_cast<std::size_t>(end - begin) > c_chunk_size)
+        {
+            const char *eol = static_cast<const char *>(std::memchr(
+                begin + c_chunk_size, '\n', end - begin - c_chunk_size));
+            split = eol ? eol + 1 : end;
+        }
+
+        chunks.push_back({begin, split, 0, {}});
+        begin = split;
+    }
+
+    return chunks;
+}
+
+/// Matches a block of whole lines on the pool and prints the selected ones,
+/// returning their number.
+std::size_t grep(
+    const fsm::Dfa &dfa,
+    const fsm::LiteralFinder &prefilter,
+    const Options &options,
+    fsmgrep::ThreadPool &pool,
+    const char *data,
+    std::size_t size,
+    const std::string &prefix)
+{
+    std::vector<Chunk> chunks = splitLines(data, size);
+
+    for (Chunk &chunk : chunks)
+    {
+        pool.submit([&]() { processChunk(dfa, prefilter, options, chunk); });
+    }
+
+    pool.wait();
+
+    std::size_t count = 0;
+
+    for (const Chunk &chunk : chunks)
+    {
+        count += chunk.count;
+
+        if (options.count)
+        {
+            continue;
+        }
+
+        if (prefix.empty())
+        {
+            std::cout << chunk.output;
+            continue;
+        }
+
+        for (std::size_t pos = 0; pos < chunk.output.size();)
+        {
+            std::size_t eol = chunk.output.find('\n', pos);
+            std::cout << prefix;
+            std::cout.write(chunk.output.data() + pos, eol - pos + 1);
+            pos = eol + 1;
+        }
+    }
+
+    return count;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+
+    try
+    {
+        if (!parseOptions(argc, argv, options))
+        {
+            printUsage();
+            return 2;
+        }
+    }
+    catch (const std::exception &)
+    {
+        printUsage();
+        return 2;
+    }
+
+    std::ios::sync_with_stdio(false);
+
+    try
+    {
+        std::string literal;
+        fsm::Fsm fsm = options.whole_line
+                           ? fsm::Regex::buildFsm(options.pattern, literal)
+                           : buildSearchFsm(options.pattern, literal);
+        fsm::Dfa dfa(fsm.min());
+        fsm::LiteralFinder prefilter(literal);
+
+        fsmgrep::ThreadPool pool(options.threads);
+
+        std::size_t count = 0;
+
+        if (options.files.empty())
+        {
+            // Standard input may be a pipe that is still being written, so
+            // it is matched block by block and the output flushed after each.
+            fsmgrep::LineReader reader(
+                STDIN_FILENO, c_chunk_size * pool.size());
+            std::size_t input_count = 0;
+
+            while (reader.next())
+            {
+                input_count += grep(
+                    dfa,
+                    prefilter,
+                    options,
+                    pool,
+                    reader.data(),
+                    reader.size(),
+                    "");
+                std::cout.flush();
+            }
+
+            if (options.count)
+            {
+                std::cout << input_count << '\n';
+            }
+
+            count += input_count;
+        }
+
+        for (const std::string &file_name : options.files)
+        {
+            fsmgrep::MappedFile file(file_name);
+            std::string prefix =
+                options.files.size() > 1 ? file_name + ":" : "";
+            std::size_t file_count = grep(
+                dfa,
+                prefilter,
+                options,
+                pool,
+                file.data(),
+                file.size(),
+                prefix);
+
+            if (options.count)
+            {
+                std::cout << prefix << file_count << '\n';
+            }
+
+            count += file_count;
+        }
+
+        return count ? 0 : 1;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "fsmgrep: " << e.what() << std::endl;
+        return 2;
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace fsm {
+
+/// Partition of the input bytes into equivalence classes.
+///
+/// Two bytes belong to the same class when no transition of an automaton
+/// tells them apart, i.e. from every state they lead to the same states. Such
+/// an automaton can be determinized, minimized and run over classes instead of
+/// bytes. Classes are numbered in the order of their smallest byte, so class 0
+/// always holds byte 0 together with every byte no transition is labelled
+/// with.
+class ByteClasses final
+{
+public: // types
+    using class_t = std::uint8_t;
+    using bytes_t = std::bitset<1 << CHAR_BIT>;
+
+public: // constants
+    static constexpr std::size_t byte_count = 1 << CHAR_BIT;
+
+public: // methods
+    ByteClasses()
+        : m_count{1}
+    {
+        m_classes.fill(0);
+        m_representatives.fill(0);
+    }
+
+    /// Number of classes, between 1 and 256.
+    std::size_t size() const
+    {
+        return m_count;
+    }
+
+    class_t operator[](unsigned char byte) const
+    {
+        return m_classes[byte];
+    }
+
+    /// Smallest byte of the class.
+    unsigned char getRepresentative(std::size_t c) const
+    {
+        return m_representatives[c];
+    }
+
+    /// Classes whose representatives lie in [first, last], as a half-open
+    /// range of class numbers. These are the classes on which an edge
+    /// labelled with the range is taken.
+    std::pair<std::size_t, std::size_t> getClassRange(
+        char first,
+        char last) const
+    {
+        const unsigned char *begin = m_representatives.data();
+        const unsigned char *end = begin + m_count;
+
+        return std::make_pair(
+            std::lower_bound(
+                begin, end, static_cast<unsigned char>(first)) -
+                begin,
+            std::upper_bound(begin, end, static_cast<unsigned char>(last)) -
+                begin);
+    }
+
+    const class_t *data() const
+    {
+        return m_classes.data();
+    }
+
+    /// Splits every class into the bytes inside and outside of @p bytes.
+    void split(const bytes_t &bytes)
+    {
+        const std::size_t none = byte_count;
+
+        std::array<std::size_t, 2 * byte_count> numbers;
+        numbers.fill(none);
+
+        std::size_t count = 0;
+
+        for (std::size_t b = 0; b < byte_count; b++)
+        {
+            std::size_t &number = numbers[2 * m_classes[b] + bytes[b]];
+
+            if (number == none)
+            {
+                m_representatives[count] = static_cast<unsigned char>(b);
+                number = count++;
+            }
+
+            m_classes[b] = static_cast<class_t>(number);
+        }
+
+        m_count = count;
+    }
+
+private: // fields
+    std::array<class_t, byte_count> m_classes;
+    std::array<unsigned char, byte_count> m_representatives;
+    std::size_t m_count;
+};
+
+} // namespace fsm
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "fsm/ByteClasses.hpp"
+#include "fsm/StateSet.hpp"
+
+namespace fsm {
+
+class Fsm;
+
+/// Deterministic automaton lowered into a flat transition table for matching.
+///
+/// Input bytes are first mapped to the byte classes of the automaton, and
+/// every state owns a row with one entry per class. States are identified by
+/// the offset of their row, so a transition is a load of table[state +
+/// class]. Missing transitions lead to the dead state 0.
+class Dfa final
+{
+public: // types
+    using state_t = std::uint32_t;
+
+public: // constants
+    static constexpr state_t dead_state = 0;
+
+    /// Smallest chunk that runParallel() gives a thread of its own.
+    static constexpr std::size_t default_min_chunk_size = 1 << 20;
+
+public: // methods
+    explicit Dfa(const Fsm &fsm);
+
+    std::size_t getStateCount() const;
+    std::size_t getClassCount() const;
+    state_t getStartingState() const;
+
+    const ByteClasses &getByteClasses() const;
+    const std::vector<state_t> &getTable() const;
+
+    /// Dense index of the state in [0, getStateCount()). The dead state has
+    /// index 0 and state s of the source automaton has index s + 1.
+    std::size_t getIndex(state_t state) const
+    {
+        return state / m_stride;
+    }
+
+    bool isFinal(state_t state) const
+    {
+        return m_final_states.contains(getIndex(state));
+    }
+
+    state_t next(state_t state, char c) const
+    {
+        return m_table[state + m_classes[static_cast<unsigned char>(c)]];
+    }
+
+    state_t run(state_t state, const char *begin, const char *end) const;
+    bool match(const char *data, std::size_t size) const;
+
+    /// Same as run(), but splits the input into one chunk per thread, with
+    /// fewer threads if the chunks would be smaller than @p min_chunk_size.
+    /// Every chunk except the first is run speculatively from all states at
+    /// once, merging the runs as they converge, and the resulting per-chunk
+    /// state maps are composed in order.
+    state_t runParallel(
+        state_t state,
+        const char *begin,
+        const char *end,
+        std::size_t threads,
+        std::size_t min_chunk_size = default_min_chunk_size) const;
+
+    bool matchParallel(
+        const char *data,
+        std::size_t size,
+        std::size_t threads,
+        std::size_t min_chunk_size = default_min_chunk_size) const;
+
+private: // methods
+    std::vector<state_t> mapChunk(const char *begin, const char *end) const;
+
+private: // fields
+    ByteClasses m_classes;
+    std::size_t m_stride;
+    std::vector<state_t> m_table;
+    StateSet m_final_states;
+    state_t m_starting_state;
+};
+
+} // namespace fsm
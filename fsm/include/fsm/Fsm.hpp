@@ -3,7 +3,9 @@
 #include <map>
 #include <ostream>
 #include <set>
+#include <string>
 #include <vector>
+#include "fsm/ByteClasses.hpp"
 
 namespace fsm {
 
@@ -13,6 +15,50 @@ public: // types
     using state_t = std::size_t;
     using symbol_t = char;
 
+    /// Edge labelled with the symbols [first, last], ordered as unsigned
+    /// bytes. Epsilon edges are labelled with '\0' alone, which is never part
+    /// of a range.
+    struct Transition
+    {
+        Transition(state_t state, symbol_t symbol)
+            : state{state}
+            , first{symbol}
+            , last{symbol}
+        {
+        }
+
+        Transition(state_t state, symbol_t first, symbol_t last)
+            : state{state}
+            , first{first}
+            , last{last}
+        {
+        }
+
+        bool isEpsilon() const
+        {
+            return first == '\0';
+        }
+
+        bool contains(symbol_t a) const
+        {
+            return static_cast<unsigned char>(a) >=
+                       static_cast<unsigned char>(first) &&
+                   static_cast<unsigned char>(a) <=
+                       static_cast<unsigned char>(last);
+        }
+
+        state_t state;
+        symbol_t first;
+        symbol_t last;
+    };
+
+    enum class Minimization
+    {
+        Brzozowski,
+        Hopcroft,
+        Auto,
+    };
+
 public: // methods
     explicit Fsm(
         std::size_t states,
@@ -20,7 +66,7 @@ public: // methods
         const std::set<state_t> &f = {});
 
     explicit Fsm(
-        const std::vector<std::vector<std::set<symbol_t>>> &t,
+        const std::vector<std::vector<Transition>> &t,
         const std::set<state_t> &s = {},
         const std::set<state_t> &f = {});
 
@@ -31,40 +77,130 @@ public: // methods
         const std::set<state_t> &f = {});
 
     void connect(state_t s1, state_t s2, symbol_t a);
+    void connect(state_t s1, state_t s2, symbol_t first, symbol_t last);
     void setStarting(state_t state, bool value = true);
     void setFinal(state_t state, bool value = true);
 
-    std::vector<std::vector<std::set<symbol_t>>> getTransitions() const;
-    std::set<state_t> getStartingStates() const;
-    std::set<state_t> getFinalStates() const;
+    const std::vector<std::vector<Transition>> &getTransitions() const;
+    const std::set<state_t> &getStartingStates() const;
+    const std::set<state_t> &getFinalStates() const;
+
+    bool isDeterministic() const;
+
+    /// Classes of bytes that no transition distinguishes.
+    ByteClasses getByteClasses() const;
 
     Fsm rev() const;
-    Fsm det() const;
-    Fsm min() const;
+
+    /// Subset construction. Large constructions can be spread over several
+    /// @p threads; the result is the same for any number of them.
+    Fsm det(std::size_t threads = 1) const;
+    Fsm det(
+        std::vector<std::set<state_t>> &final_states,
+        std::size_t threads = 1) const;
+
+    Fsm min(Minimization algorithm = Minimization::Auto) const;
 
     friend std::ostream &operator<<(std::ostream &stream, const Fsm &fsm);
 
+    /// The overloads taking rvalues move the states of their operands into
+    /// the result instead of copying them.
     static Fsm concatenation(const std::vector<Fsm> &fsms);
+    static Fsm concatenation(std::vector<Fsm> &&fsms);
     static Fsm disjunction(const std::vector<Fsm> &fsms);
+    static Fsm disjunction(std::vector<Fsm> &&fsms);
     static Fsm option(const Fsm &fsm);
+    static Fsm option(Fsm &&fsm);
     static Fsm iteration(const Fsm &fsm);
+    static Fsm iteration(Fsm &&fsm);
+
+    static Fsm intersection(const Fsm &fsm1, const Fsm &fsm2);
+    static Fsm difference(const Fsm &fsm1, const Fsm &fsm2);
+    static Fsm complement(const Fsm &fsm);
+
+    /// Whether the automata accept the same language. If not, @p
+    /// counterexample is set to a shortest word accepted by only one of them.
+    static bool equivalent(const Fsm &fsm1, const Fsm &fsm2);
+    static bool equivalent(
+        const Fsm &fsm1,
+        const Fsm &fsm2,
+        std::string &counterexample);
+
+    /// Whether every word accepted by @p fsm2 is accepted by @p fsm1. If not,
+    /// @p counterexample is set to a word accepted by @p fsm2 only.
+    static bool includes(const Fsm &fsm1, const Fsm &fsm2);
+    static bool includes(
+        const Fsm &fsm1,
+        const Fsm &fsm2,
+        std::string &counterexample);
+
+private: // types
+    class Determinizer;
+
+    enum class Product
+    {
+        Intersection,
+        Difference,
+    };
+
+    /// Sorted states of an epsilon closure.
+    struct Closure
+    {
+        const state_t *first;
+        const state_t *last;
+
+        const state_t *begin() const
+        {
+            return first;
+        }
+
+        const state_t *end() const
+        {
+            return last;
+        }
+    };
+
+    /// Closures of the strongly connected components of the epsilon edges,
+    /// stored back to back. A state without epsilon edges costs one entry.
+    struct EpsilonClosures
+    {
+        std::vector<std::size_t> components;
+        std::vector<std::size_t> offsets;
+        std::vector<state_t> states;
+
+        Closure operator[](state_t state) const
+        {
+            const std::size_t component = components[state];
+            return {states.data() + offsets[component],
+                    states.data() + offsets[component + 1]};
+        }
+    };
 
 private: // methods
     void buildAlphabet();
+    void extendAlphabet(symbol_t first, symbol_t last);
 
-    void printState(std::ostream &stream, state_t state) const;
-    std::vector<std::set<state_t>> epsilonClosures() const;
+    /// Subset construction, storing the final NFA states of every subset in
+    /// @p final_states unless it is null.
+    Fsm determinize(
+        std::vector<std::set<state_t>> *final_states,
+        std::size_t threads) const;
+
+    Fsm brzozowski() const;
+    Fsm hopcroft() const;
 
-    void buildEpsilonClosures(
-        state_t state,
-        std::vector<std::set<state_t>> &ec,
-        std::vector<bool> &flags) const;
+    static Fsm product(const Fsm &fsm1, const Fsm &fsm2, Product operation);
+
+    void printState(std::ostream &stream, state_t state) const;
+    std::vector<std::vector<Transition>> reverseTransitions() const;
+    EpsilonClosures epsilonClosures() const;
 
     void ensureAtomic() const;
+    void append(Fsm &&fsm);
 
 private: // fields
     std::set<symbol_t> m_alphabet;
-    std::vector<std::vector<std::set<symbol_t>>> m_transitions;
+    std::vector<std::vector<Transition>> m_transitions;
     std::set<state_t> m_starting_states;
     std::set<state_t> m_final_states;
 };
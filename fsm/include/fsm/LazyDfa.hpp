@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "fsm/ByteClasses.hpp"
+
+namespace fsm {
+
+class Fsm;
+
+/// Deterministic automaton built on demand from an NFA while matching.
+///
+/// Only the subsets that the input actually reaches are determinized. They are
+/// kept in a cache of bounded size, and the whole cache is flushed once the
+/// budget is exhausted, so memory stays fixed however large the equivalent
+/// eager DFA would be. A flush invalidates every state id handed out before
+/// it. Cached rows have one entry per byte class of the NFA.
+class LazyDfa final
+{
+public: // types
+    using state_t = std::uint32_t;
+
+public: // constants
+    static constexpr std::size_t default_cache_size = 8 << 20;
+    static constexpr state_t dead_state = 0;
+
+public: // methods
+    explicit LazyDfa(
+        const Fsm &fsm,
+        std::size_t cache_size = default_cache_size);
+
+    state_t getStartingState() const;
+    std::size_t getFlushCount() const;
+
+    bool isFinal(state_t state) const
+    {
+        return m_final_flags[state / m_stride];
+    }
+
+    state_t next(state_t state, char c);
+    state_t run(state_t state, const char *begin, const char *end);
+    bool match(const char *data, std::size_t size);
+
+private: // types
+    struct Transition
+    {
+        unsigned char first;
+        unsigned char last;
+        state_t state;
+    };
+
+private: // methods
+    state_t computeNext(state_t state, unsigned char c);
+    state_t addState(const std::vector<state_t> &subset);
+    void closeOver(std::vector<state_t> &subset);
+    void flush();
+    void rehash();
+
+    std::size_t getMemoryUsage() const;
+
+private: // fields
+    std::vector<std::vector<Transition>> m_transitions;
+    std::vector<std::vector<state_t>> m_epsilon_transitions;
+    std::vector<bool> m_final_states;
+    std::vector<state_t> m_starting_states;
+    ByteClasses m_classes;
+    std::size_t m_stride;
+
+    std::size_t m_cache_size;
+    std::size_t m_flush_count;
+
+    std::vector<state_t> m_table;
+    std::vector<bool> m_final_flags;
+    std::vector<state_t> m_arena;
+    std::vector<std::size_t> m_offsets;
+    std::vector<std::size_t> m_hashes;
+    std::vector<std::size_t> m_buckets;
+    state_t m_starting_state;
+
+    std::vector<std::uint32_t> m_marks;
+    std::uint32_t m_generation;
+    std::vector<state_t> m_scratch;
+};
+
+} // namespace fsm
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace fsm {
+
+/// Searches buffers for a fixed string.
+///
+/// Used as a prefilter: if every match of a regex contains the literal,
+/// input without it is rejected without running an automaton. On SSE2
+/// targets 16 candidate positions are tested at once by comparing their
+/// first and last bytes with the literal's, and only positions where both
+/// agree are compared in full. Elsewhere the search falls back to memchr.
+class LiteralFinder final
+{
+public: // methods
+    explicit LiteralFinder(const std::string &literal = "");
+
+    const std::string &getLiteral() const;
+
+    /// First occurrence of the literal in [begin, end), or nullptr. An empty
+    /// literal is found at @p begin.
+    const char *find(const char *begin, const char *end) const;
+
+private: // fields
+    std::string m_literal;
+};
+
+} // namespace fsm
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace fsm {
+
+class Fsm;
+
+/// Matches directly on a nondeterministic automaton, without determinizing.
+///
+/// The automaton is first viewed as a position automaton: one position per
+/// target state and edge label, plus one for the start. If that gives at
+/// most 256 positions, the active positions live in a bit mask of up to four
+/// words and every input byte costs a table-driven Follow step and one AND
+/// with the mask of positions labelled by the byte. Larger automata are
+/// simulated over their original states with sparse sets. Either way,
+/// matching is linear in the input.
+class Nfa final
+{
+public: // methods
+    explicit Nfa(const Fsm &fsm);
+
+    bool isBitParallel() const;
+
+    bool match(const char *data, std::size_t size);
+
+private: // types
+    class SparseSet final
+    {
+    public: // methods
+        explicit SparseSet(std::size_t capacity = 0)
+            : m_dense(capacity)
+            , m_sparse(capacity)
+            , m_size{0}
+        {
+        }
+
+        bool contains(std::size_t value) const
+        {
+            std::size_t i = m_sparse[value];
+            return i < m_size && m_dense[i] == value;
+        }
+
+        void insert(std::size_t value)
+        {
+            m_sparse[value] = m_size;
+            m_dense[m_size++] = value;
+        }
+
+        void clear()
+        {
+            m_size = 0;
+        }
+
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+        std::size_t operator[](std::size_t i) const
+        {
+            return m_dense[i];
+        }
+
+    private: // fields
+        std::vector<std::size_t> m_dense;
+        std::vector<std::size_t> m_sparse;
+        std::size_t m_size;
+    };
+
+    struct Transition
+    {
+        unsigned char first;
+        unsigned char last;
+        std::size_t state;
+    };
+
+private: // methods
+    void buildPositions();
+
+    template <std::size_t W>
+    bool matchBitParallel(const char *data, std::size_t size) const;
+
+    bool matchSparse(const char *data, std::size_t size);
+    void addClosure(SparseSet &set, std::size_t state);
+
+private: // fields
+    std::vector<std::vector<Transition>> m_transitions;
+    std::vector<std::vector<std::size_t>> m_epsilon_transitions;
+    std::vector<bool> m_final_states;
+    std::vector<std::size_t> m_starting_states;
+
+    std::size_t m_words;
+    std::vector<std::uint64_t> m_follow;
+    std::vector<std::uint64_t> m_symbols;
+    std::vector<std::uint64_t> m_final_positions;
+
+    SparseSet m_current;
+    SparseSet m_next;
+    std::vector<std::size_t> m_stack;
+};
+
+} // namespace fsm
@@ -1,20 +1,102 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace fsm {
 
 class Fsm;
 class RegexImpl;
+class Stream;
 
 class Regex final
 {
+public: // types
+    enum class Engine
+    {
+        Dfa,
+        LazyDfa,
+        Nfa,
+    };
+
+    /// How buildFsm() compiles a pattern. Thompson joins the automata of the
+    /// subexpressions with epsilon edges. Glushkov builds the position
+    /// automaton: epsilon-free, with one state per character, character set
+    /// or wildcard of the pattern plus a starting state.
+    enum class Construction
+    {
+        Thompson,
+        Glushkov,
+    };
+
+    /// Offsets [begin, end) of a match in the searched string.
+    struct Span
+    {
+        std::size_t begin;
+        std::size_t end;
+    };
+
 public: // methods
-    Regex(const std::string &pattern);
+    Regex(const std::string &pattern, Engine engine = Engine::Dfa);
+    Regex(Regex &&other);
+    ~Regex();
+
+    Regex &operator=(Regex &&other);
+
     bool match(const std::string &str);
 
-    static Fsm buildFsm(const std::string &pattern);
+    /// Matches a single large input on several threads. Only Engine::Dfa
+    /// runs in parallel; the other engines match sequentially.
+    bool match(const std::string &str, std::size_t threads);
+
+    /// Finds the leftmost match in @p str, and the longest one starting
+    /// there. Searching runs a forward and a reverse DFA built on first use,
+    /// lazy ones unless the engine is Engine::Dfa. Returns false if nothing
+    /// matches.
+    bool find(const std::string &str, Span &span);
+
+    /// All leftmost-longest matches in @p str, left to right, without
+    /// overlaps. After an empty match the search resumes one byte later.
+    std::vector<Span> findAll(const std::string &str);
+
+    /// Matches the whole of @p str like match(), and on success stores in
+    /// @p groups the span of the whole string as group 0 and the spans of
+    /// the parenthesised subexpressions, numbered from 1 by their opening
+    /// parentheses. A group that takes no part in the match spans
+    /// std::string::npos. Where the match is ambiguous, iterations are
+    /// greedy and earlier alternatives win, even over the empty string. A
+    /// group under an iteration spans its last repetition, which may be an
+    /// empty one ending the iteration. Uses a tagged automaton built on first
+    /// use, whatever the engine, and a single pass over the input.
+    bool capture(const std::string &str, std::vector<Span> &groups);
+
+    /// Starts a chunked match against this regex. Requires Engine::Dfa, and
+    /// the regex must outlive the stream. The match is anchored at the start
+    /// of the stream: the callback receives the end of every prefix that
+    /// matches, not of matches starting later. A pattern beginning with .*
+    /// reports the ends of matches anywhere.
+    Stream stream(
+        std::function<void(std::uint64_t end)> callback = nullptr) const;
+
+    static Fsm buildFsm(
+        const std::string &pattern,
+        Construction construction = Construction::Glushkov);
+
+    /// Like buildFsm(), and also stores requiredLiteral() in @p literal,
+    /// parsing the pattern only once.
+    static Fsm buildFsm(
+        const std::string &pattern,
+        std::string &literal,
+        Construction construction = Construction::Glushkov);
+
+    /// Longest string that every match of the pattern contains, or an empty
+    /// string if there is none. Inputs without it cannot match, so it can
+    /// be searched for before running an automaton.
+    static std::string requiredLiteral(const std::string &pattern);
 
 private: // fields
     std::unique_ptr<RegexImpl> m_impl;
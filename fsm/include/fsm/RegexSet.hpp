@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "fsm/Dfa.hpp"
+
+namespace fsm {
+
+/// Matches a string against many patterns in a single pass.
+///
+/// The patterns are compiled into one automaton whose accepting states are
+/// tagged with the ids of the patterns they accept, where the id of a pattern
+/// is its index in the constructor argument.
+class RegexSet final
+{
+public: // methods
+    explicit RegexSet(const std::vector<std::string> &patterns);
+
+    std::size_t size() const;
+
+    std::vector<std::size_t> match(const std::string &str) const;
+    bool matchAny(const std::string &str) const;
+
+private: // methods
+    static Dfa compile(
+        const std::vector<std::string> &patterns,
+        std::vector<std::vector<std::size_t>> &matches);
+
+private: // fields
+    std::size_t m_size;
+    std::vector<std::vector<std::size_t>> m_matches;
+    Dfa m_dfa;
+};
+
+} // namespace fsm
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fsm {
+
+/// Dynamic bitset over the states [0, size) of an automaton.
+///
+/// Membership tests and updates touch a single word, and findNext() skips a
+/// word of absent states at a time. det() keeps the members of a subset in
+/// one while it builds the subset, and Dfa its final states.
+class StateSet final
+{
+public: // types
+    using word_t = std::uint64_t;
+
+public: // constants
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+    static constexpr std::size_t word_bits = 64;
+
+public: // methods
+    explicit StateSet(std::size_t size = 0)
+        : m_size{size}
+        , m_words((size + word_bits - 1) / word_bits, 0)
+    {
+    }
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool contains(std::size_t state) const
+    {
+        return (m_words[state / word_bits] >> (state % word_bits)) & 1;
+    }
+
+    void insert(std::size_t state)
+    {
+        m_words[state / word_bits] |= word_t{1} << (state % word_bits);
+    }
+
+    void erase(std::size_t state)
+    {
+        m_words[state / word_bits] &= ~(word_t{1} << (state % word_bits));
+    }
+
+    /// Returns the smallest state not less than @p from, or npos.
+    std::size_t findNext(std::size_t from) const
+    {
+        std::size_t i = from / word_bits;
+
+        if (i >= m_words.size())
+        {
+            return npos;
+        }
+
+        word_t w = m_words[i] & (~word_t{0} << (from % word_bits));
+
+        while (!w)
+        {
+            if (++i == m_words.size())
+            {
+                return npos;
+            }
+
+            w = m_words[i];
+        }
+
+        return i * word_bits + countTrailingZeros(w);
+    }
+
+private: // methods
+    static std::size_t countTrailingZeros(word_t w)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(w);
+#else
+        std::size_t n = 0;
+        while (!(w & 1))
+        {
+            w >>= 1;
+            n++;
+        }
+        return n;
+#endif
+    }
+
+private: // fields
+    std::size_t m_size;
+    std::vector<word_t> m_words;
+};
+
+} // namespace fsm
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "fsm/Dfa.hpp"
+
+namespace fsm {
+
+/// Runs a Dfa over input that arrives in arbitrary chunks.
+///
+/// The automaton state and the global offset are carried over from one
+/// feed() to the next, so a stream can be scanned in constant memory without
+/// assembling it. If a callback is given, it receives the global end offset
+/// of every prefix of the stream, since the last reset(), that the automaton
+/// accepts. Matching is therefore anchored at the start of the stream; an
+/// automaton for .* followed by a pattern reports matches anywhere. The Dfa
+/// must outlive the stream.
+class Stream final
+{
+public: // types
+    using Callback = std::function<void(std::uint64_t end)>;
+
+public: // methods
+    explicit Stream(const Dfa &dfa, Callback callback = nullptr);
+
+    void feed(const char *data, std::size_t size);
+    void reset();
+
+    bool isMatch() const;
+    std::uint64_t getOffset() const;
+
+private: // fields
+    const Dfa &m_dfa;
+    Callback m_callback;
+    Dfa::state_t m_state;
+    std::uint64_t m_offset;
+};
+
+} // namespace fsm
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "fsm/ByteClasses.hpp"
+
+namespace fsm {
+
+/// Epsilon-free automaton whose edges record the input offset in tags, for
+/// extracting submatches in a single pass over the input.
+///
+/// The edges out of a state are ordered by priority: of all the paths that
+/// accept the input, match() reports the tags of the one taking the higher
+/// priority edge where they first part. If no state has two edges on the
+/// same byte, the automaton is one-pass and runs as a DFA over a table
+/// indexed by state and byte class, writing the tags as it goes. Otherwise
+/// every active state carries its own copy of the tags, and a state reached
+/// by several paths keeps the copy of the highest priority one. Either way,
+/// matching is linear in the input and never backtracks.
+class TaggedNfa final
+{
+public: // types
+    using state_t = std::size_t;
+    using tag_t = std::uint32_t;
+
+    /// Edge taken on the bytes in [first, last], recording the offset of
+    /// the byte in @p tags.
+    struct Transition
+    {
+        state_t state;
+        char first;
+        char last;
+        std::vector<tag_t> tags;
+    };
+
+    /// Edges out of a state in order of priority. If the state is final,
+    /// accepting in it records the end of the input in @p final_tags.
+    struct State
+    {
+        std::vector<Transition> transitions;
+        bool final;
+        std::vector<tag_t> final_tags;
+    };
+
+public: // constants
+    /// Offset of a tag that the accepting path does not record.
+    static constexpr std::size_t npos = std::string::npos;
+
+public: // methods
+    /// State 0 is the starting state.
+    TaggedNfa(const std::vector<State> &states, std::size_t tags);
+
+    bool isOnePass() const;
+
+    /// Matches the whole input. On success, @p offsets holds the offset of
+    /// every tag.
+    bool match(
+        const char *data,
+        std::size_t size,
+        std::vector<std::size_t> &offsets);
+
+private: // types
+    struct Edge
+    {
+        state_t state;
+        unsigned char first;
+        unsigned char last;
+        std::uint32_t tags_begin;
+        std::uint32_t tags_end;
+    };
+
+private: // methods
+    std::pair<std::uint32_t, std::uint32_t> addTags(
+        const std::vector<tag_t> &tags);
+
+    void buildTable();
+    bool isSameEdge(const Edge &a, const Edge &b) const;
+
+    bool matchOnePass(
+        const char *data,
+        std::size_t size,
+        std::vector<std::size_t> &offsets) const;
+
+    bool matchThreads(
+        const char *data,
+        std::size_t size,
+        std::vector<std::size_t> &offsets);
+
+    void record(
+        std::size_t *offsets,
+        std::uint32_t begin,
+        std::uint32_t end,
+        std::size_t offset) const;
+
+private: // fields
+    std::size_t m_tag_count;
+    std::vector<tag_t> m_tags;
+    std::vector<Edge> m_edges;
+    std::vector<std::uint32_t> m_edges_begin;
+    std::vector<bool> m_final_states;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> m_final_tags;
+
+    ByteClasses m_classes;
+    std::vector<std::uint32_t> m_table;
+
+    std::vector<state_t> m_current;
+    std::vector<state_t> m_next;
+    std::vector<std::size_t> m_current_offsets;
+    std::vector<std::size_t> m_next_offsets;
+    std::vector<bool> m_visited;
+};
+
+} // namespace fsm
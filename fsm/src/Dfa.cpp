@@ -0,0 +1,252 @@
+#include "fsm/Dfa.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include "fsm/Fsm.hpp"
+
+namespace fsm {
+
+namespace {
+
+const std::size_t c_convergence_block = 256;
+
+} // namespace
+
+constexpr Dfa::state_t Dfa::dead_state;
+constexpr std::size_t Dfa::default_min_chunk_size;
+
+Dfa::Dfa(const Fsm &fsm)
+    : m_classes{fsm.getByteClasses()}
+    , m_stride{m_classes.size()}
+{
+    if (!fsm.isDeterministic())
+    {
+        throw std::runtime_error("FSM is not deterministic");
+    }
+
+    const auto &transitions = fsm.getTransitions();
+    const std::size_t states = transitions.size() + 1;
+
+    if (states > std::numeric_limits<state_t>::max() / m_stride)
+    {
+        throw std::runtime_error("FSM is too large");
+    }
+
+    m_table.assign(states * m_stride, dead_state);
+    m_final_states = StateSet(states);
+
+    for (std::size_t s = 0; s < transitions.size(); s++)
+    {
+        for (const Fsm::Transition &tr : transitions[s])
+        {
+            auto range = m_classes.getClassRange(tr.first, tr.last);
+
+            for (std::size_t c = range.first; c < range.second; c++)
+            {
+                m_table[(s + 1) * m_stride + c] =
+                    static_cast<state_t>((tr.state + 1) * m_stride);
+            }
+        }
+    }
+
+    for (Fsm::state_t s : fsm.getFinalStates())
+    {
+        m_final_states.insert(s + 1);
+    }
+
+    m_starting_state =
+        static_cast<state_t>((*fsm.getStartingStates().begin() + 1) * m_stride);
+}
+
+std::size_t Dfa::getStateCount() const
+{
+    return m_table.size() / m_stride;
+}
+
+std::size_t Dfa::getClassCount() const
+{
+    return m_stride;
+}
+
+Dfa::state_t Dfa::getStartingState() const
+{
+    return m_starting_state;
+}
+
+const ByteClasses &Dfa::getByteClasses() const
+{
+    return m_classes;
+}
+
+const std::vector<Dfa::state_t> &Dfa::getTable() const
+{
+    return m_table;
+}
+
+Dfa::state_t Dfa::run(state_t state, const char *begin, const char *end) const
+{
+    const state_t *table = m_table.data();
+    const ByteClasses::class_t *classes = m_classes.data();
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(begin);
+    const unsigned char *e = reinterpret_cast<const unsigned char *>(end);
+
+    while (e - p >= 4)
+    {
+        state = table[state + classes[p[0]]];
+        state = table[state + classes[p[1]]];
+        state = table[state + classes[p[2]]];
+        state = table[state + classes[p[3]]];
+        p += 4;
+    }
+
+    while (p != e)
+    {
+        state = table[state + classes[*p++]];
+    }
+
+    return state;
+}
+
+bool Dfa::match(const char *data, std::size_t size) const
+{
+    return isFinal(run(m_starting_state, data, data + size));
+}
+
+Dfa::state_t Dfa::runParallel(
+    state_t state,
+    const char *begin,
+    const char *end,
+    std::size_t threads,
+    std::size_t min_chunk_size) const
+{
+    const std::size_t size = end - begin;
+
+    threads = std::min(
+        threads, size / std::max<std::size_t>(min_chunk_size, 1));
+
+    if (threads <= 1)
+    {
+        return run(state, begin, end);
+    }
+
+    const std::size_t chunk_size = size / threads;
+
+    std::vector<std::vector<state_t>> maps(threads);
+    std::vector<std::thread> workers;
+
+    for (std::size_t i = 1; i < threads; i++)
+    {
+        const char *chunk_begin = begin + i * chunk_size;
+        const char *chunk_end =
+            i + 1 == threads ? end : chunk_begin + chunk_size;
+
+        workers.emplace_back([=, &maps]() {
+            maps[i] = mapChunk(chunk_begin, chunk_end);
+        });
+    }
+
+    state = run(state, begin, begin + chunk_size);
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    for (std::size_t i = 1; i < threads; i++)
+    {
+        state = maps[i][getIndex(state)];
+    }
+
+    return state;
+}
+
+bool Dfa::matchParallel(
+    const char *data,
+    std::size_t size,
+    std::size_t threads,
+    std::size_t min_chunk_size) const
+{
+    return isFinal(runParallel(
+        m_starting_state, data, data + size, threads, min_chunk_size));
+}
+
+/// Returns the state reached from every state, indexed by getIndex(). All
+/// states are advanced block by block, and after every block the runs that
+/// have reached the same state are merged, so once they have all converged
+/// the rest of the chunk costs no more than a plain run().
+std::vector<Dfa::state_t> Dfa::mapChunk(
+    const char *begin,
+    const char *end) const
+{
+    const std::size_t states = getStateCount();
+
+    std::vector<state_t> active(states);
+    std::vector<std::size_t> owners(states);
+
+    for (std::size_t i = 0; i < states; i++)
+    {
+        active[i] = static_cast<state_t>(i * m_stride);
+        owners[i] = i;
+    }
+
+    std::vector<std::pair<state_t, std::size_t>> runs;
+    std::vector<std::size_t> remap;
+
+    while (begin != end && active.size() > 1)
+    {
+        const char *block_end =
+            begin + std::min<std::size_t>(end - begin, c_convergence_block);
+
+        for (state_t &s : active)
+        {
+            s = run(s, begin, block_end);
+        }
+
+        begin = block_end;
+
+        runs.clear();
+
+        for (std::size_t i = 0; i < active.size(); i++)
+        {
+            runs.emplace_back(active[i], i);
+        }
+
+        std::sort(runs.begin(), runs.end());
+
+        remap.resize(active.size());
+        active.clear();
+
+        for (const auto &r : runs)
+        {
+            if (active.empty() || active.back() != r.first)
+            {
+                active.push_back(r.first);
+            }
+
+            remap[r.second] = active.size() - 1;
+        }
+
+        for (std::size_t &owner : owners)
+        {
+            owner = remap[owner];
+        }
+    }
+
+    for (state_t &s : active)
+    {
+        s = run(s, begin, end);
+    }
+
+    std::vector<state_t> map(states);
+
+    for (std::size_t i = 0; i < states; i++)
+    {
+        map[i] = active[owners[i]];
+    }
+
+    return map;
+}
+
+} // namespace fsm
@@ -1,10 +1,336 @@
 #include "fsm/Fsm.hpp"
 #include <algorithm>
+#include <climits>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+#include "fsm/StateSet.hpp"
 
 namespace fsm {
 
+namespace {
+
+const std::size_t c_no_state = static_cast<std::size_t>(-1);
+
+bool transitionLess(const Fsm::Transition &t1, const Fsm::Transition &t2)
+{
+    auto key = [](const Fsm::Transition &tr) {
+        return std::make_tuple(
+            tr.state,
+            static_cast<unsigned char>(tr.first),
+            static_cast<unsigned char>(tr.last));
+    };
+
+    return key(t1) < key(t2);
+}
+
+bool transitionEqual(const Fsm::Transition &t1, const Fsm::Transition &t2)
+{
+    return t1.state == t2.state && t1.first == t2.first && t1.last == t2.last;
+}
+
+/// Appends an edge for every run of adjacent bytes whose classes lead to the
+/// same state. @p targets holds the target of every class, or c_no_state.
+void appendRanges(
+    std::vector<Fsm::Transition> &row,
+    const ByteClasses &classes,
+    const std::vector<std::size_t> &targets)
+{
+    std::size_t b = 1;
+
+    while (b < ByteClasses::byte_count)
+    {
+        const std::size_t target = targets[classes[b]];
+
+        if (target == c_no_state)
+        {
+            b++;
+            continue;
+        }
+
+        std::size_t last = b;
+
+        while (last + 1 < ByteClasses::byte_count &&
+               targets[classes[last + 1]] == target)
+        {
+            last++;
+        }
+
+        row.emplace_back(
+            target, static_cast<char>(b), static_cast<char>(last));
+
+        b = last + 1;
+    }
+}
+
+/// Interns subsets of NFA states during subset construction.
+///
+/// Subsets are sorted lists of 32-bit NFA states, stored back to back in a
+/// single arena, so a subset costs its own size rather than the number of
+/// NFA states. Lookup goes through an open-addressing hash table that keeps the
+/// hash of every subset, so full comparisons only happen on hash hits. find()
+/// and get() do not modify the table and may run concurrently as long as
+/// nothing is inserted at the same time.
+class SubsetTable final
+{
+public: // types
+    using Subset = std::vector<std::uint32_t>;
+
+public: // constants
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+public: // methods
+    explicit SubsetTable(std::size_t states)
+        : m_offsets{0}
+        , m_buckets(16, npos)
+    {
+        if (states > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::runtime_error("FSM is too large");
+        }
+    }
+
+    std::size_t size() const
+    {
+        return m_hashes.size();
+    }
+
+    /// Total size of the subsets [first, last).
+    std::size_t memberCount(std::size_t first, std::size_t last) const
+    {
+        return m_offsets[last] - m_offsets[first];
+    }
+
+    void get(std::size_t index, Subset &subset) const
+    {
+        subset.assign(
+            m_arena.begin() + m_offsets[index],
+            m_arena.begin() + m_offsets[index + 1]);
+    }
+
+    /// Returns the index of the subset with the given hash, or npos.
+    std::size_t find(const Subset &subset, std::size_t hash) const
+    {
+        return m_buckets[findBucket(subset, hash)];
+    }
+
+    /// Returns the index of the subset, adding it to the table if it is not
+    /// there yet.
+    std::size_t insert(const Subset &subset, std::size_t hash)
+    {
+        std::size_t bucket = findBucket(subset, hash);
+
+        if (m_buckets[bucket] != npos)
+        {
+            return m_buckets[bucket];
+        }
+
+        std::size_t index = size();
+
+        m_buckets[bucket] = index;
+        m_hashes.push_back(hash);
+        m_arena.insert(m_arena.end(), subset.begin(), subset.end());
+        m_offsets.push_back(m_arena.size());
+
+        if (2 * size() > m_buckets.size())
+        {
+            rehash();
+        }
+
+        return index;
+    }
+
+    std::size_t insert(const Subset &subset)
+    {
+        return insert(subset, hash(subset));
+    }
+
+    static std::size_t hash(const Subset &subset)
+    {
+        std::uint64_t hash = 0x9e3779b97f4a7c15ull;
+
+        for (Fsm::state_t s : subset)
+        {
+            hash ^= s + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        }
+
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+
+        return static_cast<std::size_t>(hash);
+    }
+
+private: // methods
+    std::size_t findBucket(const Subset &subset, std::size_t hash) const
+    {
+        std::size_t mask = m_buckets.size() - 1;
+
+        for (std::size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            std::size_t index = m_buckets[i];
+
+            if (index == npos ||
+                (m_hashes[index] == hash &&
+                 m_offsets[index + 1] - m_offsets[index] == subset.size() &&
+                 std::equal(
+                     subset.begin(),
+                     subset.end(),
+                     m_arena.begin() + m_offsets[index])))
+            {
+                return i;
+            }
+        }
+    }
+
+    void rehash()
+    {
+        std::vector<std::size_t> buckets(m_buckets.size() * 2, npos);
+        std::size_t mask = buckets.size() - 1;
+
+        for (std::size_t index = 0; index < size(); index++)
+        {
+            std::size_t i = m_hashes[index] & mask;
+
+            while (buckets[i] != npos)
+            {
+                i = (i + 1) & mask;
+            }
+
+            buckets[i] = index;
+        }
+
+        m_buckets.swap(buckets);
+    }
+
+private: // fields
+    Subset m_arena;
+    std::vector<std::size_t> m_offsets;
+    std::vector<std::size_t> m_hashes;
+    std::vector<std::size_t> m_buckets;
+};
+
+constexpr std::size_t SubsetTable::npos;
+
+/// Outcome of one byte class of a subset expansion in det(). Targets that
+/// were not in the subset table yet carry the subset itself and its hash.
+struct SubsetMove
+{
+    std::size_t byte_class;
+    std::size_t target;
+    std::size_t hash;
+    SubsetTable::Subset subset;
+};
+
+/// Sets @p subset to the sorted union of the epsilon closures of @p targets.
+/// @p members is an empty scratch set over the NFA states, and is left empty.
+/// A target that is already in the union is skipped, since its closure is
+/// part of the closure it came with.
+template <class Closures>
+void mergeClosures(
+    const Closures &closures,
+    const std::vector<Fsm::state_t> &targets,
+    StateSet &members,
+    SubsetTable::Subset &subset)
+{
+    subset.clear();
+
+    for (Fsm::state_t target : targets)
+    {
+        if (members.contains(target))
+        {
+            continue;
+        }
+
+        for (Fsm::state_t s : closures[target])
+        {
+            if (!members.contains(s))
+            {
+                members.insert(s);
+                subset.push_back(static_cast<std::uint32_t>(s));
+            }
+        }
+    }
+
+    // Without epsilon edges, the targets often come out sorted already. A
+    // union that is dense within its range is read back off the bitset,
+    // which is cheaper than sorting it.
+    if (!std::is_sorted(subset.begin(), subset.end()))
+    {
+        auto range = std::minmax_element(subset.begin(), subset.end());
+        const std::size_t first = *range.first;
+        const std::size_t count = subset.size();
+
+        if ((*range.second - first) / StateSet::word_bits < count)
+        {
+            subset.clear();
+
+            for (std::size_t s = members.findNext(first); subset.size() < count;
+                 s = members.findNext(s + 1))
+            {
+                subset.push_back(static_cast<std::uint32_t>(s));
+            }
+        }
+        else
+        {
+            std::sort(subset.begin(), subset.end());
+        }
+    }
+
+    for (std::uint32_t s : subset)
+    {
+        members.erase(s);
+    }
+}
+
+const std::size_t c_det_batch_size = 1024;
+const std::size_t c_min_det_members_per_thread = 1 << 12;
+
+/// Common refinement of two byte partitions.
+ByteClasses refine(ByteClasses classes, const ByteClasses &other)
+{
+    for (std::size_t c = 1; c < other.size(); c++)
+    {
+        ByteClasses::bytes_t bytes;
+
+        for (std::size_t b = 0; b < ByteClasses::byte_count; b++)
+        {
+            bytes[b] = other[static_cast<unsigned char>(b)] == c;
+        }
+
+        classes.split(bytes);
+    }
+
+    return classes;
+}
+
+/// Last symbol of a word and the index of the step holding the word's
+/// prefix, for the searches that report counterexamples.
+struct WordStep
+{
+    std::size_t parent;
+    char symbol;
+};
+
+std::string traceWord(const std::vector<WordStep> &steps, std::size_t i)
+{
+    std::string word;
+
+    for (; steps[i].parent != c_no_state; i = steps[i].parent)
+    {
+        word += steps[i].symbol;
+    }
+
+    return std::string(word.rbegin(), word.rend());
+}
+
+} // namespace
+
 Fsm::Fsm(
     std::size_t states,
     const std::set<state_t> &s,
@@ -13,20 +339,23 @@ Fsm::Fsm(
     , m_starting_states(s)
     , m_final_states(f)
 {
-    for (std::vector<std::set<symbol_t>> &t : m_transitions)
-    {
-        t.resize(states);
-    }
 }
 
 Fsm::Fsm(
-    const std::vector<std::vector<std::set<symbol_t>>> &t,
+    const std::vector<std::vector<Transition>> &t,
     const std::set<state_t> &s,
     const std::set<state_t> &f)
     : m_transitions(t)
     , m_starting_states(s)
     , m_final_states(f)
 {
+    for (auto &row : m_transitions)
+    {
+        std::sort(row.begin(), row.end(), transitionLess);
+        row.erase(
+            std::unique(row.begin(), row.end(), transitionEqual), row.end());
+    }
+
     buildAlphabet();
 }
 
@@ -40,11 +369,6 @@ Fsm::Fsm(
     , m_starting_states(s)
     , m_final_states(f)
 {
-    for (auto &row : m_transitions)
-    {
-        row.resize(t.size());
-    }
-
     for (state_t s1 = 0; s1 < t.size(); s1++)
     {
         auto it = alphabet.begin();
@@ -62,338 +386,1349 @@ Fsm::Fsm(
             }
         }
     }
-}
+}
+
+void Fsm::connect(state_t s1, state_t s2, symbol_t a)
+{
+    connect(s1, s2, a, a);
+}
+
+/// Connects the states with an edge labelled by the byte range [first, last].
+/// A range starting at '\0' excludes it, since '\0' alone stands for epsilon.
+void Fsm::connect(state_t s1, state_t s2, symbol_t first, symbol_t last)
+{
+    if (first == '\0' && last != '\0')
+    {
+        first = '\1';
+    }
+
+    if (static_cast<unsigned char>(first) > static_cast<unsigned char>(last))
+    {
+        throw std::runtime_error("invalid symbol range");
+    }
+
+    std::vector<Transition> &row = m_transitions[s1];
+    const Transition tr{s2, first, last};
+
+    auto it = std::lower_bound(row.begin(), row.end(), tr, transitionLess);
+
+    if (it == row.end() || transitionLess(tr, *it))
+    {
+        row.insert(it, tr);
+    }
+
+    if (!tr.isEpsilon())
+    {
+        extendAlphabet(first, last);
+    }
+}
+
+void Fsm::setStarting(state_t state, bool value)
+{
+    if (value)
+    {
+        m_starting_states.insert(state);
+    }
+    else
+    {
+        m_starting_states.erase(state);
+    }
+}
+
+void Fsm::setFinal(state_t state, bool value)
+{
+    if (value)
+    {
+        m_final_states.insert(state);
+    }
+    else
+    {
+        m_final_states.erase(state);
+    }
+}
+
+const std::vector<std::vector<Fsm::Transition>> &Fsm::getTransitions() const
+{
+    return m_transitions;
+}
+
+const std::set<Fsm::state_t> &Fsm::getStartingStates() const
+{
+    return m_starting_states;
+}
+
+const std::set<Fsm::state_t> &Fsm::getFinalStates() const
+{
+    return m_final_states;
+}
+
+bool Fsm::isDeterministic() const
+{
+    if (m_starting_states.size() != 1)
+    {
+        return false;
+    }
+
+    std::vector<std::pair<unsigned char, unsigned char>> ranges;
+
+    for (const auto &row : m_transitions)
+    {
+        ranges.clear();
+
+        for (const Transition &tr : row)
+        {
+            if (tr.isEpsilon())
+            {
+                return false;
+            }
+
+            ranges.emplace_back(tr.first, tr.last);
+        }
+
+        std::sort(ranges.begin(), ranges.end());
+
+        for (std::size_t i = 1; i < ranges.size(); i++)
+        {
+            if (ranges[i].first <= ranges[i - 1].second)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+ByteClasses Fsm::getByteClasses() const
+{
+    std::unordered_set<ByteClasses::bytes_t> labels;
+
+    for (const auto &row : m_transitions)
+    {
+        // Rows are sorted by target, so the symbols leading to the same
+        // state are adjacent.
+        for (auto it = row.begin(); it != row.end();)
+        {
+            ByteClasses::bytes_t bytes;
+            const state_t target = it->state;
+
+            for (; it != row.end() && it->state == target; ++it)
+            {
+                if (it->isEpsilon())
+                {
+                    continue;
+                }
+
+                for (unsigned a = static_cast<unsigned char>(it->first);
+                     a <= static_cast<unsigned char>(it->last);
+                     a++)
+                {
+                    bytes.set(a);
+                }
+            }
+
+            if (bytes.any())
+            {
+                labels.insert(bytes);
+            }
+        }
+    }
+
+    ByteClasses classes;
+
+    for (const ByteClasses::bytes_t &bytes : labels)
+    {
+        classes.split(bytes);
+    }
+
+    return classes;
+}
+
+Fsm Fsm::rev() const
+{
+    Fsm rfsm(m_transitions.size(), m_final_states, m_starting_states);
+
+    rfsm.m_alphabet = m_alphabet;
+    rfsm.m_transitions = reverseTransitions();
+
+    return rfsm;
+}
+
+Fsm Fsm::det(std::size_t threads) const
+{
+    return determinize(nullptr, threads);
+}
+
+Fsm Fsm::det(
+    std::vector<std::set<state_t>> &final_states,
+    std::size_t threads) const
+{
+    return determinize(&final_states, threads);
+}
+
+/// Subset construction over batches of unexpanded subsets. The subsets of a
+/// batch are expanded against the subset table as it was at the start of
+/// the batch, on up to @p threads threads if the batch holds enough states
+/// to pay for starting them. The targets that turn out to be new are
+/// interned afterwards in subset and class order, so the numbering of the
+/// result does not depend on the number of threads. Moves are computed once
+/// per byte class rather than once per symbol, and new subsets are numbered
+/// in the order of the smallest byte leading to them.
+Fsm Fsm::determinize(
+    std::vector<std::set<state_t>> *final_states,
+    std::size_t threads) const
+{
+    const std::size_t states = m_transitions.size();
+    const EpsilonClosures &closures = epsilonClosures();
+
+    const ByteClasses classes = getByteClasses();
+    const std::size_t class_count = classes.size();
+
+    SubsetTable q(states);
+
+    {
+        const std::vector<state_t> starts(
+            m_starting_states.begin(), m_starting_states.end());
+        StateSet members(states);
+
+        SubsetTable::Subset q0;
+        mergeClosures(closures, starts, members, q0);
+        q.insert(q0);
+    }
+
+    // The targets of the edges out of a subset are gathered by byte class
+    // first, and the closures of each class merged once.
+    struct Scratch
+    {
+        SubsetTable::Subset subset;
+        SubsetTable::Subset move;
+        std::vector<std::vector<state_t>> targets;
+        std::vector<std::size_t> touched;
+        StateSet members;
+    };
+
+    auto expand = [&](std::size_t index,
+                      Scratch &scratch,
+                      std::vector<SubsetMove> &result) {
+        q.get(index, scratch.subset);
+
+        for (state_t i : scratch.subset)
+        {
+            for (const Transition &tr : m_transitions[i])
+            {
+                if (tr.isEpsilon())
+                {
+                    continue;
+                }
+
+                auto range = classes.getClassRange(tr.first, tr.last);
+
+                for (std::size_t k = range.first; k < range.second; k++)
+                {
+                    if (scratch.targets[k].empty())
+                    {
+                        scratch.touched.push_back(k);
+                    }
+
+                    scratch.targets[k].push_back(tr.state);
+                }
+            }
+        }
+
+        std::sort(scratch.touched.begin(), scratch.touched.end());
+        result.clear();
+
+        for (std::size_t k : scratch.touched)
+        {
+            mergeClosures(
+                closures,
+                scratch.targets[k],
+                scratch.members,
+                scratch.move);
+            scratch.targets[k].clear();
+
+            std::size_t hash = SubsetTable::hash(scratch.move);
+            std::size_t target = q.find(scratch.move, hash);
+
+            result.push_back({k, target, hash, {}});
+
+            if (target == SubsetTable::npos)
+            {
+                result.back().subset = scratch.move;
+            }
+        }
+
+        scratch.touched.clear();
+    };
+
+    std::vector<Scratch> scratches(
+        std::max<std::size_t>(threads, 1),
+        {{},
+         {},
+         std::vector<std::vector<state_t>>(class_count),
+         {},
+         StateSet(states)});
+
+    std::vector<std::vector<SubsetMove>> expansions;
+    std::vector<std::vector<Transition>> t;
+    std::vector<std::size_t> targets(class_count, c_no_state);
+
+    while (t.size() < q.size())
+    {
+        const std::size_t batch_begin = t.size();
+        const std::size_t batch_size =
+            std::min(q.size() - batch_begin, c_det_batch_size);
+        const std::size_t members =
+            q.memberCount(batch_begin, batch_begin + batch_size);
+        const std::size_t workers = std::max<std::size_t>(
+            1,
+            std::min(threads, members / c_min_det_members_per_thread));
+
+        expansions.resize(batch_size);
+
+        auto work = [&](std::size_t worker) {
+            for (std::size_t i = worker; i < batch_size; i += workers)
+            {
+                expand(batch_begin + i, scratches[worker], expansions[i]);
+            }
+        };
+
+        std::vector<std::thread> pool;
+
+        for (std::size_t worker = 1; worker < workers; worker++)
+        {
+            pool.emplace_back(work, worker);
+        }
+
+        work(0);
+
+        for (std::thread &thread : pool)
+        {
+            thread.join();
+        }
+
+        for (std::size_t i = 0; i < batch_size; i++)
+        {
+            for (const SubsetMove &move : expansions[i])
+            {
+                targets[move.byte_class] =
+                    move.target == SubsetTable::npos
+                        ? q.insert(move.subset, move.hash)
+                        : move.target;
+            }
+
+            std::vector<Transition> row;
+            appendRanges(row, classes, targets);
+
+            for (const SubsetMove &move : expansions[i])
+            {
+                targets[move.byte_class] = c_no_state;
+            }
+
+            t.push_back(row);
+        }
+    }
+
+    SubsetTable::Subset subset;
+
+    StateSet finals(states);
+
+    for (state_t s : m_final_states)
+    {
+        finals.insert(s);
+    }
+
+    std::set<state_t> f;
+
+    if (final_states)
+    {
+        final_states->assign(q.size(), {});
+    }
+
+    for (std::size_t i = 0; i < q.size(); i++)
+    {
+        q.get(i, subset);
+
+        for (state_t s : subset)
+        {
+            if (!finals.contains(s))
+            {
+                continue;
+            }
+
+            f.insert(i);
+
+            if (!final_states)
+            {
+                break;
+            }
+
+            (*final_states)[i].insert(s);
+        }
+    }
+
+    Fsm dfa(t, {0}, f);
+    dfa.m_alphabet = m_alphabet;
+
+    return dfa;
+}
+
+Fsm Fsm::min(Minimization algorithm) const
+{
+    switch (algorithm)
+    {
+    case Minimization::Brzozowski:
+        return brzozowski();
+
+    case Minimization::Hopcroft:
+        return hopcroft();
+
+    case Minimization::Auto:
+        break;
+    }
+
+    return isDeterministic() ? hopcroft() : brzozowski();
+}
+
+std::ostream &operator<<(std::ostream &stream, const Fsm &fsm)
+{
+    for (Fsm::state_t s = 0; s < fsm.m_transitions.size(); s++)
+    {
+        for (const Fsm::Transition &tr : fsm.m_transitions[s])
+        {
+            fsm.printState(stream, s);
+
+            if (tr.isEpsilon())
+            {
+                stream << " --->> ";
+            }
+            else if (tr.first == tr.last)
+            {
+                stream << " --" << tr.first << "-> ";
+            }
+            else
+            {
+                stream << " --[" << tr.first << "-" << tr.last << "]-> ";
+            }
+
+            fsm.printState(stream, tr.state);
+
+            stream << std::endl;
+        }
+    }
+
+    return stream;
+}
+
+Fsm Fsm::concatenation(const std::vector<Fsm> &fsms)
+{
+    return concatenation(std::vector<Fsm>(fsms));
+}
+
+///@todo Remove unnecessary epsilon transitions
+Fsm Fsm::concatenation(std::vector<Fsm> &&fsms)
+{
+    std::size_t states_num = 2;
+
+    for (const auto &fsm : fsms)
+    {
+        fsm.ensureAtomic();
+        states_num += fsm.m_transitions.size();
+    }
+
+    Fsm res(1);
+    res.m_transitions.reserve(states_num);
+
+    state_t global_start = 0;
+    state_t global_end = states_num - 1;
+
+    res.setStarting(global_start);
+    res.setFinal(global_end);
+
+    state_t prev_end = global_start;
+
+    for (auto &fsm : fsms)
+    {
+        const state_t offset = res.m_transitions.size();
+
+        state_t start = *fsm.m_starting_states.begin() + offset;
+        state_t end = *fsm.m_final_states.begin() + offset;
+
+        res.append(std::move(fsm));
+
+        res.connect(prev_end, start, '\0');
+        prev_end = end;
+    }
+
+    res.m_transitions.emplace_back();
+
+    res.connect(prev_end, global_end, '\0');
+
+    return res;
+}
+
+Fsm Fsm::disjunction(const std::vector<Fsm> &fsms)
+{
+    return disjunction(std::vector<Fsm>(fsms));
+}
+
+///@todo Boilerplate
+Fsm Fsm::disjunction(std::vector<Fsm> &&fsms)
+{
+    std::size_t states_num = 2;
+
+    for (const auto &fsm : fsms)
+    {
+        fsm.ensureAtomic();
+        states_num += fsm.m_transitions.size();
+    }
+
+    Fsm res(1);
+    res.m_transitions.reserve(states_num);
+
+    state_t global_start = 0;
+    state_t global_end = states_num - 1;
+
+    res.setStarting(global_start);
+    res.setFinal(global_end);
+
+    for (auto &fsm : fsms)
+    {
+        const state_t offset = res.m_transitions.size();
+
+        state_t start = *fsm.m_starting_states.begin() + offset;
+        state_t end = *fsm.m_final_states.begin() + offset;
+
+        res.append(std::move(fsm));
+
+        res.connect(global_start, start, '\0');
+        res.connect(end, global_end, '\0');
+    }
+
+    res.m_transitions.emplace_back();
+
+    return res;
+}
+
+Fsm Fsm::option(const Fsm &fsm)
+{
+    return option(Fsm(fsm));
+}
+
+Fsm Fsm::option(Fsm &&fsm)
+{
+    fsm.ensureAtomic();
+
+    state_t start = *fsm.m_starting_states.begin();
+    state_t end = *fsm.m_final_states.begin();
+
+    Fsm res = std::move(fsm);
+
+    res.connect(start, end, '\0');
+
+    return res;
+}
+
+Fsm Fsm::iteration(const Fsm &fsm)
+{
+    return iteration(Fsm(fsm));
+}
+
+Fsm Fsm::iteration(Fsm &&fsm)
+{
+    fsm.ensureAtomic();
+
+    state_t start = *fsm.m_starting_states.begin();
+    state_t end = *fsm.m_final_states.begin();
+
+    Fsm res = std::move(fsm);
+
+    res.connect(end, start, '\0');
+
+    return res;
+}
+
+Fsm Fsm::intersection(const Fsm &fsm1, const Fsm &fsm2)
+{
+    return product(fsm1, fsm2, Product::Intersection);
+}
+
+Fsm Fsm::difference(const Fsm &fsm1, const Fsm &fsm2)
+{
+    return product(fsm1, fsm2, Product::Difference);
+}
+
+/// Complement with respect to all the strings of bytes other than '\0'.
+Fsm Fsm::complement(const Fsm &fsm)
+{
+    Fsm universe(1, {0}, {0});
+    universe.connect(0, 0, '\x01', '\xff');
+
+    return difference(universe, fsm);
+}
+
+void Fsm::buildAlphabet()
+{
+    m_alphabet.clear();
+
+    for (const auto &row : m_transitions)
+    {
+        for (const Transition &tr : row)
+        {
+            if (!tr.isEpsilon())
+            {
+                extendAlphabet(tr.first, tr.last);
+            }
+        }
+    }
+}
+
+void Fsm::extendAlphabet(symbol_t first, symbol_t last)
+{
+    for (unsigned a = static_cast<unsigned char>(first);
+         a <= static_cast<unsigned char>(last);
+         a++)
+    {
+        m_alphabet.insert(static_cast<symbol_t>(a));
+    }
+}
+
+Fsm Fsm::brzozowski() const
+{
+    return rev().det().rev().det();
+}
+
+Fsm Fsm::hopcroft() const
+{
+    if (!isDeterministic())
+    {
+        return det().hopcroft();
+    }
+
+    static const std::size_t none = static_cast<std::size_t>(-1);
+
+    // The partition is refined over byte classes, which is enough since all
+    // the bytes of a class lead from every state to the same state.
+
+    const ByteClasses classes = getByteClasses();
+    const std::size_t k = classes.size();
+
+    // Keep only reachable states, plus an explicit dead state at the end that
+    // completes the transition function.
+
+    std::vector<std::size_t> indices(m_transitions.size(), none);
+    std::vector<state_t> states{*m_starting_states.begin()};
+    indices[states[0]] = 0;
+
+    for (std::size_t i = 0; i < states.size(); i++)
+    {
+        for (const Transition &tr : m_transitions[states[i]])
+        {
+            if (indices[tr.state] == none)
+            {
+                indices[tr.state] = states.size();
+                states.push_back(tr.state);
+            }
+        }
+    }
+
+    const std::size_t n = states.size() + 1;
+    const std::size_t dead = n - 1;
+
+    std::vector<std::size_t> delta(n * k, dead);
+
+    for (std::size_t i = 0; i < dead; i++)
+    {
+        for (const Transition &tr : m_transitions[states[i]])
+        {
+            auto range = classes.getClassRange(tr.first, tr.last);
+
+            for (std::size_t c = range.first; c < range.second; c++)
+            {
+                delta[i * k + c] = indices[tr.state];
+            }
+        }
+    }
+
+    // Inverse transition function, grouped by symbol and target state.
+
+    std::vector<std::size_t> inv_offsets(k * n + 1, 0);
+    std::vector<std::size_t> inv(n * k);
+
+    for (std::size_t s = 0; s < n; s++)
+    {
+        for (std::size_t a = 0; a < k; a++)
+        {
+            inv_offsets[a * n + delta[s * k + a] + 1]++;
+        }
+    }
+
+    for (std::size_t i = 1; i < inv_offsets.size(); i++)
+    {
+        inv_offsets[i] += inv_offsets[i - 1];
+    }
+
+    {
+        std::vector<std::size_t> cursors(
+            inv_offsets.begin(), inv_offsets.end() - 1);
+
+        for (std::size_t s = 0; s < n; s++)
+        {
+            for (std::size_t a = 0; a < k; a++)
+            {
+                inv[cursors[a * n + delta[s * k + a]]++] = s;
+            }
+        }
+    }
+
+    // Refinable partition: every block is a contiguous range of elems, and
+    // the marked states of a block are kept at the front of its range.
+
+    std::vector<bool> is_final(n, false);
+
+    for (std::size_t i = 0; i < dead; i++)
+    {
+        is_final[i] = m_final_states.find(states[i]) != m_final_states.end();
+    }
+
+    std::vector<std::size_t> elems;
+    elems.reserve(n);
+
+    for (std::size_t s = 0; s < n; s++)
+    {
+        if (is_final[s])
+        {
+            elems.push_back(s);
+        }
+    }
+
+    const std::size_t final_count = elems.size();
+
+    for (std::size_t s = 0; s < n; s++)
+    {
+        if (!is_final[s])
+        {
+            elems.push_back(s);
+        }
+    }
+
+    std::vector<std::size_t> loc(n);
+    std::vector<std::size_t> block_of(n);
+
+    std::vector<std::size_t> first;
+    std::vector<std::size_t> end;
+    std::vector<std::size_t> mid;
+
+    std::vector<std::pair<std::size_t, std::size_t>> worklist;
+    std::vector<bool> in_worklist;
+
+    auto add_splitter = [&](std::size_t b, std::size_t a) {
+        in_worklist[b * k + a] = true;
+        worklist.emplace_back(b, a);
+    };
+
+    if (final_count > 0)
+    {
+        first.push_back(0);
+        end.push_back(final_count);
+        mid.push_back(0);
+    }
+
+    first.push_back(final_count);
+    end.push_back(n);
+    mid.push_back(final_count);
+
+    for (std::size_t b = 0; b < first.size(); b++)
+    {
+        for (std::size_t i = first[b]; i < end[b]; i++)
+        {
+            loc[elems[i]] = i;
+            block_of[elems[i]] = b;
+        }
+    }
+
+    in_worklist.resize(first.size() * k, false);
+
+    if (first.size() == 2)
+    {
+        std::size_t smaller = end[0] - first[0] <= end[1] - first[1] ? 0 : 1;
+
+        for (std::size_t a = 0; a < k; a++)
+        {
+            add_splitter(smaller, a);
+        }
+    }
+
+    std::vector<std::size_t> splitter;
+    std::vector<std::size_t> touched;
+
+    while (!worklist.empty())
+    {
+        std::size_t b = worklist.back().first;
+        std::size_t a = worklist.back().second;
+        worklist.pop_back();
+        in_worklist[b * k + a] = false;
+
+        splitter.assign(elems.begin() + first[b], elems.begin() + end[b]);
+
+        for (std::size_t t : splitter)
+        {
+            for (std::size_t j = inv_offsets[a * n + t];
+                 j < inv_offsets[a * n + t + 1];
+                 j++)
+            {
+                std::size_t s = inv[j];
+                std::size_t x = block_of[s];
+
+                if (loc[s] < mid[x])
+                {
+                    continue;
+                }
+
+                if (mid[x] == first[x])
+                {
+                    touched.push_back(x);
+                }
+
+                std::size_t p = mid[x]++;
+                std::size_t other = elems[p];
+
+                elems[p] = s;
+                elems[loc[s]] = other;
+                loc[other] = loc[s];
+                loc[s] = p;
+            }
+        }
+
+        for (std::size_t x : touched)
+        {
+            if (mid[x] == end[x])
+            {
+                mid[x] = first[x];
+                continue;
+            }
+
+            std::size_t y = first.size();
+
+            first.push_back(first[x]);
+            end.push_back(mid[x]);
+            mid.push_back(first[x]);
+
+            first[x] = end[y];
+            mid[x] = first[x];
+
+            for (std::size_t i = first[y]; i < end[y]; i++)
+            {
+                block_of[elems[i]] = y;
+            }
+
+            in_worklist.resize(first.size() * k, false);
+
+            bool y_smaller = end[y] - first[y] <= end[x] - first[x];
+
+            for (std::size_t c = 0; c < k; c++)
+            {
+                if (in_worklist[x * k + c] || y_smaller)
+                {
+                    add_splitter(y, c);
+                }
+                else
+                {
+                    add_splitter(x, c);
+                }
+            }
+        }
+
+        touched.clear();
+    }
+
+    // Number the blocks in breadth-first order, the same way det() numbers
+    // subsets, and drop the block of the dead state.
+
+    const std::size_t dead_block = block_of[dead];
+
+    std::vector<std::size_t> numbers(first.size(), none);
+    std::vector<std::size_t> order;
+
+    std::vector<std::vector<Transition>> t;
+    std::vector<std::size_t> targets(k);
+    std::set<state_t> f;
+
+    if (block_of[0] == dead_block)
+    {
+        t.emplace_back();
+    }
+    else
+    {
+        numbers[block_of[0]] = 0;
+        order.push_back(block_of[0]);
+    }
+
+    for (std::size_t i = 0; i < order.size(); i++)
+    {
+        std::size_t rep = elems[first[order[i]]];
+
+        for (std::size_t c = 0; c < k; c++)
+        {
+            std::size_t target = block_of[delta[rep * k + c]];
+
+            if (target == dead_block)
+            {
+                targets[c] = c_no_state;
+                continue;
+            }
+
+            if (numbers[target] == none)
+            {
+                numbers[target] = order.size();
+                order.push_back(target);
+            }
+
+            targets[c] = numbers[target];
+        }
+
+        std::vector<Transition> row;
+        appendRanges(row, classes, targets);
+
+        if (is_final[rep])
+        {
+            f.insert(i);
+        }
+
+        t.push_back(row);
+    }
+
+    Fsm dfa(t, {0}, f);
+    dfa.m_alphabet = m_alphabet;
+
+    return dfa;
+}
+
+/// Subset construction on demand, over a fixed partition of the bytes. Used
+/// by the operations that only need the part of the deterministic automaton
+/// they actually visit. State 0 is the starting subset, and the empty subset
+/// is an ordinary state, so next() is defined for every state and class.
+class Fsm::Determinizer final
+{
+public: // methods
+    Determinizer(const Fsm &fsm, const ByteClasses &classes)
+        : m_fsm(fsm)
+        , m_classes(classes)
+        , m_closures(fsm.epsilonClosures())
+        , m_subsets(fsm.m_transitions.size())
+        , m_finals(fsm.m_transitions.size())
+        , m_targets(classes.size())
+        , m_members(fsm.m_transitions.size())
+    {
+        for (state_t s : fsm.m_final_states)
+        {
+            m_finals.insert(s);
+        }
+
+        const std::vector<state_t> starts(
+            fsm.m_starting_states.begin(), fsm.m_starting_states.end());
+
+        mergeClosures(m_closures, starts, m_members, m_subset);
+        add(m_subset);
+    }
 
-void Fsm::connect(state_t s1, state_t s2, symbol_t a)
-{
-    m_transitions[s1][s2].insert(a);
-    if (a)
+    std::size_t size() const
     {
-        m_alphabet.insert(a);
+        return m_final_flags.size();
     }
-}
 
-void Fsm::setStarting(state_t state, bool value)
-{
-    if (value)
+    bool isFinal(std::size_t state) const
     {
-        m_starting_states.insert(state);
+        return m_final_flags[state];
     }
-    else
+
+    bool isDead(std::size_t state) const
     {
-        m_starting_states.erase(state);
+        return m_dead_flags[state];
     }
-}
 
-void Fsm::setFinal(state_t state, bool value)
-{
-    if (value)
+    void getSubset(std::size_t state, SubsetTable::Subset &subset) const
     {
-        m_final_states.insert(state);
+        m_subsets.get(state, subset);
     }
-    else
+
+    std::size_t next(std::size_t state, std::size_t byte_class)
     {
-        m_final_states.erase(state);
-    }
-}
+        if (!m_expanded[state])
+        {
+            expand(state);
+        }
 
-std::vector<std::vector<std::set<Fsm::symbol_t>>> Fsm::getTransitions() const
-{
-    return m_transitions;
-}
+        return m_table[state * m_classes.size() + byte_class];
+    }
 
-std::set<Fsm::state_t> Fsm::getStartingStates() const
-{
-    return m_starting_states;
-}
+private: // methods
+    std::size_t add(const SubsetTable::Subset &subset)
+    {
+        const std::size_t index = m_subsets.insert(subset);
 
-std::set<Fsm::state_t> Fsm::getFinalStates() const
-{
-    return m_final_states;
-}
+        if (index == size())
+        {
+            m_final_flags.push_back(std::any_of(
+                subset.begin(), subset.end(), [&](state_t s) {
+                    return m_finals.contains(s);
+                }));
+            m_dead_flags.push_back(subset.empty());
+            m_expanded.push_back(false);
+            m_table.resize(m_table.size() + m_classes.size());
+        }
 
-Fsm Fsm::rev() const
-{
-    Fsm rfsm(m_transitions.size(), m_final_states, m_starting_states);
+        return index;
+    }
 
-    for (state_t s1 = 0; s1 < m_transitions.size(); s1++)
+    void expand(std::size_t state)
     {
-        for (state_t s2 = 0; s2 < m_transitions.size(); s2++)
+        m_subsets.get(state, m_subset);
+
+        for (state_t s : m_subset)
         {
-            for (symbol_t a : m_transitions[s1][s2])
+            for (const Transition &tr : m_fsm.m_transitions[s])
             {
-                rfsm.connect(s2, s1, a);
+                if (tr.isEpsilon())
+                {
+                    continue;
+                }
+
+                auto range = m_classes.getClassRange(tr.first, tr.last);
+
+                for (std::size_t k = range.first; k < range.second; k++)
+                {
+                    m_targets[k].push_back(tr.state);
+                }
             }
         }
-    }
 
-    return rfsm;
-}
+        for (std::size_t k = 0; k < m_classes.size(); k++)
+        {
+            mergeClosures(
+                m_closures, m_targets[k], m_members, m_move);
+            m_targets[k].clear();
 
-Fsm Fsm::det() const
-{
-    const std::vector<std::set<state_t>> &closures = epsilonClosures();
+            std::size_t target = add(m_move);
+            m_table[state * m_classes.size() + k] = target;
+        }
+
+        m_expanded[state] = true;
+    }
 
-    std::vector<std::set<state_t>> q;
+private: // fields
+    const Fsm &m_fsm;
+    ByteClasses m_classes;
+    EpsilonClosures m_closures;
+    SubsetTable m_subsets;
+    StateSet m_finals;
+    SubsetTable::Subset m_subset;
+    SubsetTable::Subset m_move;
+    std::vector<std::vector<state_t>> m_targets;
+    StateSet m_members;
+
+    std::vector<std::size_t> m_table;
+    std::vector<bool> m_final_flags;
+    std::vector<bool> m_dead_flags;
+    std::vector<bool> m_expanded;
+};
+
+/// Subset construction run on both automata in lockstep. Only the pairs of
+/// subsets reachable from the starting pair are built, so the result never
+/// holds more states than the operation actually needs. Pairs whose first
+/// subset is empty, or for an intersection either subset, are dead and
+/// dropped.
+Fsm Fsm::product(const Fsm &fsm1, const Fsm &fsm2, Product operation)
+{
+    const ByteClasses classes =
+        refine(fsm1.getByteClasses(), fsm2.getByteClasses());
 
-    std::set<state_t> q0;
+    Determinizer d1(fsm1, classes);
+    Determinizer d2(fsm2, classes);
 
-    for (state_t s : m_starting_states)
-    {
-        q0.insert(closures[s].begin(), closures[s].end());
-    }
+    std::map<std::pair<std::size_t, std::size_t>, state_t> numbers;
+    std::vector<std::pair<std::size_t, std::size_t>> order;
+    std::vector<std::size_t> targets(classes.size(), c_no_state);
 
-    q.push_back(q0);
+    numbers[std::make_pair(0, 0)] = 0;
+    order.emplace_back(0, 0);
 
-    std::vector<std::vector<std::vector<state_t>>> t;
+    std::vector<std::vector<Transition>> t;
+    std::set<state_t> f;
 
-    while (t.size() < q.size())
+    for (std::size_t i = 0; i < order.size(); i++)
     {
-        std::vector<std::vector<state_t>> row;
+        const std::size_t s1 = order[i].first;
+        const std::size_t s2 = order[i].second;
 
-        for (symbol_t a : m_alphabet)
+        if (d1.isFinal(s1) &&
+            (operation == Product::Intersection ? d2.isFinal(s2)
+                                                : !d2.isFinal(s2)))
         {
-            std::set<state_t> ts;
+            f.insert(i);
+        }
 
-            for (state_t i : q[t.size()])
-            {
-                for (state_t s = 0; s < m_transitions.size(); s++)
-                {
-                    if (m_transitions[i][s].find(a) !=
-                        m_transitions[i][s].end())
-                    {
-                        ts.insert(closures[s].begin(), closures[s].end());
-                    }
-                }
-            }
+        for (std::size_t k = 1; k < classes.size(); k++)
+        {
+            auto key = std::make_pair(d1.next(s1, k), d2.next(s2, k));
 
-            if (ts.empty())
+            if (d1.isDead(key.first) ||
+                (operation == Product::Intersection && d2.isDead(key.second)))
             {
-                row.push_back({});
                 continue;
             }
 
-            state_t index;
+            auto it = numbers.find(key);
 
-            const auto &it = std::find(q.begin(), q.end(), ts);
-
-            if (it == q.end())
-            {
-                index = q.size();
-                q.push_back(ts);
-            }
-            else
+            if (it == numbers.end())
             {
-                index = it - q.begin();
+                it = numbers.emplace(key, order.size()).first;
+                order.push_back(key);
             }
 
-            row.push_back({index});
+            targets[k] = it->second;
         }
 
-        row.push_back({});
+        std::vector<Transition> row;
+        appendRanges(row, classes, targets);
+        std::fill(targets.begin(), targets.end(), c_no_state);
 
         t.push_back(row);
     }
 
-    std::set<state_t> f;
-
-    for (std::size_t i = 0; i < q.size(); i++)
-    {
-        for (state_t s : q[i])
-        {
-            if (m_final_states.find(s) != m_final_states.end())
-            {
-                f.insert(i);
-            }
-        }
-    }
-
-    return Fsm(m_alphabet, t, {0}, f);
+    return Fsm(t, {0}, f);
 }
 
-Fsm Fsm::min() const
+bool Fsm::equivalent(const Fsm &fsm1, const Fsm &fsm2)
 {
-    return rev().det().rev().det();
+    std::string counterexample;
+    return equivalent(fsm1, fsm2, counterexample);
 }
 
-std::ostream &operator<<(std::ostream &stream, const Fsm &fsm)
+/// Hopcroft and Karp's check on the subset automata, built on the fly. Pairs
+/// of states are merged with union-find as soon as they are reached, so a
+/// pair is only explored if its states are not already known to be
+/// equivalent. The pairs are visited breadth first, which makes the first
+/// pair that disagrees on acceptance end a shortest counterexample.
+bool Fsm::equivalent(
+    const Fsm &fsm1,
+    const Fsm &fsm2,
+    std::string &counterexample)
 {
-    for (Fsm::state_t s1 = 0; s1 < fsm.m_transitions.size(); s1++)
-    {
-        for (Fsm::state_t s2 = 0; s2 < fsm.m_transitions.size(); s2++)
-        {
-            for (Fsm::symbol_t a : fsm.m_transitions[s1][s2])
-            {
-                fsm.printState(stream, s1);
+    const ByteClasses classes =
+        refine(fsm1.getByteClasses(), fsm2.getByteClasses());
 
-                if (a == '\0')
-                {
-                    stream << " --->> ";
-                }
-                else
-                {
-                    stream << " --" << a << "-> ";
-                }
+    Determinizer d1(fsm1, classes);
+    Determinizer d2(fsm2, classes);
 
-                fsm.printState(stream, s2);
+    // States of the first automaton get even ids and states of the second
+    // one odd ids.
+    std::vector<std::size_t> parents;
+
+    auto find = [&](std::size_t x) {
+        if (x >= parents.size())
+        {
+            std::size_t size = parents.size();
+            parents.resize(x + 1);
 
-                stream << std::endl;
+            for (std::size_t i = size; i <= x; i++)
+            {
+                parents[i] = i;
             }
         }
-    }
-
-    return stream;
-}
-
-///@todo Remove unnecessary epsilon transitions
-Fsm Fsm::concatenation(const std::vector<Fsm> &fsms)
-{
-    std::size_t states_num = 2;
 
-    std::set<symbol_t> alphabet;
+        while (parents[x] != x)
+        {
+            parents[x] = parents[parents[x]];
+            x = parents[x];
+        }
 
-    for (const auto &fsm : fsms)
-    {
-        fsm.ensureAtomic();
-        states_num += fsm.getTransitions().size();
-        alphabet.insert(fsm.m_alphabet.begin(), fsm.m_alphabet.end());
-    }
+        return x;
+    };
 
-    Fsm res(states_num);
-    res.m_alphabet = alphabet;
+    auto unite = [&](std::size_t x, std::size_t y) {
+        x = find(x);
+        y = find(y);
 
-    std::size_t global_index = 1;
+        if (x == y)
+        {
+            return false;
+        }
 
-    state_t global_start = 0;
-    state_t global_end = states_num - 1;
+        parents[x] = y;
+        return true;
+    };
 
-    res.setStarting(global_start);
-    res.setFinal(global_end);
+    std::vector<std::pair<std::size_t, std::size_t>> pairs{{0, 0}};
+    std::vector<WordStep> steps{{c_no_state, '\0'}};
 
-    state_t prev_end = global_start;
+    unite(0, 1);
 
-    for (const auto &fsm : fsms)
+    for (std::size_t i = 0; i < pairs.size(); i++)
     {
-        auto transitions = fsm.getTransitions();
+        const std::size_t s1 = pairs[i].first;
+        const std::size_t s2 = pairs[i].second;
 
-        for (state_t i = 0; i < transitions.size(); i++)
+        if (d1.isFinal(s1) != d2.isFinal(s2))
         {
-            for (state_t j = 0; j < transitions.size(); j++)
-            {
-                res.m_transitions[global_index + i][global_index + j] =
-                    transitions[i][j];
-            }
+            counterexample = traceWord(steps, i);
+            return false;
         }
 
-        state_t start = *fsm.getStartingStates().begin();
-        state_t end = *fsm.getFinalStates().begin();
-
-        res.connect(prev_end, start + global_index, '\0');
-        prev_end = end + global_index;
+        for (std::size_t k = 1; k < classes.size(); k++)
+        {
+            std::size_t t1 = d1.next(s1, k);
+            std::size_t t2 = d2.next(s2, k);
 
-        global_index += transitions.size();
+            if (unite(2 * t1, 2 * t2 + 1))
+            {
+                pairs.emplace_back(t1, t2);
+                steps.push_back(
+                    {i, static_cast<char>(classes.getRepresentative(k))});
+            }
+        }
     }
 
-    res.connect(prev_end, global_end, '\0');
+    counterexample.clear();
+    return true;
+}
 
-    return res;
+bool Fsm::includes(const Fsm &fsm1, const Fsm &fsm2)
+{
+    std::string counterexample;
+    return includes(fsm1, fsm2, counterexample);
 }
 
-///@todo Boilerplate
-Fsm Fsm::disjunction(const std::vector<Fsm> &fsms)
+/// Antichain-based check. The pairs explored are a state of @p fsm2 and the
+/// subset of @p fsm1 reached on the same word, and @p fsm2 has a word that
+/// @p fsm1 rejects iff such a pair with a final state and a non-final subset
+/// is reachable. A pair whose subset contains the subset of another pair
+/// with the same state can only reach counterexamples that the other pair
+/// reaches as well, so only the pairs with minimal subsets are kept, and
+/// @p fsm1 is never determinized beyond what those pairs need.
+bool Fsm::includes(
+    const Fsm &fsm1,
+    const Fsm &fsm2,
+    std::string &counterexample)
 {
-    std::size_t states_num = 2;
+    const ByteClasses classes =
+        refine(fsm1.getByteClasses(), fsm2.getByteClasses());
 
-    std::set<symbol_t> alphabet;
+    Determinizer d1(fsm1, classes);
+    const EpsilonClosures closures = fsm2.epsilonClosures();
 
-    for (const auto &fsm : fsms)
+    struct Pair
     {
-        fsm.ensureAtomic();
-        states_num += fsm.getTransitions().size();
-        alphabet.insert(fsm.m_alphabet.begin(), fsm.m_alphabet.end());
-    }
+        state_t state;
+        std::size_t subset;
+        bool removed;
+    };
 
-    Fsm res(states_num);
-    res.m_alphabet = alphabet;
+    std::vector<Pair> pairs;
+    std::vector<WordStep> steps;
+    std::vector<std::vector<std::size_t>> antichains(
+        fsm2.m_transitions.size());
 
-    std::size_t global_index = 1;
+    SubsetTable::Subset subset;
+    SubsetTable::Subset other;
 
-    state_t global_start = 0;
-    state_t global_end = states_num - 1;
+    // Whether every state of a is also in b.
+    auto is_subset = [](const SubsetTable::Subset &a,
+                        const SubsetTable::Subset &b) {
+        return std::includes(b.begin(), b.end(), a.begin(), a.end());
+    };
 
-    res.setStarting(global_start);
-    res.setFinal(global_end);
+    auto add = [&](state_t state, std::size_t s, WordStep step) {
+        std::vector<std::size_t> &antichain = antichains[state];
 
-    for (const auto &fsm : fsms)
-    {
-        auto transitions = fsm.getTransitions();
+        d1.getSubset(s, subset);
 
-        for (state_t i = 0; i < transitions.size(); i++)
+        for (std::size_t i : antichain)
         {
-            for (state_t j = 0; j < transitions.size(); j++)
+            d1.getSubset(pairs[i].subset, other);
+
+            if (is_subset(other, subset))
             {
-                res.m_transitions[global_index + i][global_index + j] =
-                    transitions[i][j];
+                return;
             }
         }
 
-        state_t start = *fsm.getStartingStates().begin();
-        state_t end = *fsm.getFinalStates().begin();
+        std::size_t size = 0;
 
-        res.connect(global_start, start + global_index, '\0');
-        res.connect(end + global_index, global_end, '\0');
-
-        global_index += transitions.size();
-    }
-
-    return res;
-}
+        for (std::size_t i : antichain)
+        {
+            d1.getSubset(pairs[i].subset, other);
 
-Fsm Fsm::option(const Fsm &fsm)
-{
-    fsm.ensureAtomic();
+            if (is_subset(subset, other))
+            {
+                pairs[i].removed = true;
+            }
+            else
+            {
+                antichain[size++] = i;
+            }
+        }
 
-    state_t start = *fsm.getStartingStates().begin();
-    state_t end = *fsm.getFinalStates().begin();
+        antichain.resize(size);
+        antichain.push_back(pairs.size());
 
-    Fsm res = fsm;
+        pairs.push_back({state, s, false});
+        steps.push_back(step);
+    };
 
-    res.connect(start, end, '\0');
+    const std::vector<state_t> starts(
+        fsm2.m_starting_states.begin(), fsm2.m_starting_states.end());
+    StateSet members(fsm2.m_transitions.size());
 
-    return res;
-}
+    SubsetTable::Subset start;
+    mergeClosures(closures, starts, members, start);
 
-Fsm Fsm::iteration(const Fsm &fsm)
-{
-    fsm.ensureAtomic();
+    for (state_t s : start)
+    {
+        add(s, 0, {c_no_state, '\0'});
+    }
 
-    state_t start = *fsm.getStartingStates().begin();
-    state_t end = *fsm.getFinalStates().begin();
+    for (std::size_t i = 0; i < pairs.size(); i++)
+    {
+        if (pairs[i].removed)
+        {
+            continue;
+        }
 
-    Fsm res = fsm;
+        const state_t state = pairs[i].state;
+        const std::size_t s = pairs[i].subset;
 
-    res.connect(end, start, '\0');
+        if (fsm2.m_final_states.count(state) && !d1.isFinal(s))
+        {
+            counterexample = traceWord(steps, i);
+            return false;
+        }
 
-    return res;
-}
+        for (const Transition &tr : fsm2.m_transitions[state])
+        {
+            if (tr.isEpsilon())
+            {
+                continue;
+            }
 
-void Fsm::buildAlphabet()
-{
-    m_alphabet.clear();
+            auto range = classes.getClassRange(tr.first, tr.last);
 
-    for (state_t s1 = 0; s1 < m_transitions.size(); s1++)
-    {
-        for (state_t s2 = 0; s2 < m_transitions.size(); s2++)
-        {
-            for (symbol_t a : m_transitions[s1][s2])
+            for (std::size_t k = range.first; k < range.second; k++)
             {
-                if (a)
+                const std::size_t target = d1.next(s, k);
+                const WordStep step{
+                    i, static_cast<char>(classes.getRepresentative(k))};
+
+                for (state_t q : closures[tr.state])
                 {
-                    m_alphabet.insert(a);
+                    add(q, target, step);
                 }
             }
         }
     }
+
+    counterexample.clear();
+    return true;
 }
 
 void Fsm::printState(std::ostream &stream, state_t state) const
@@ -419,44 +1754,177 @@ void Fsm::printState(std::ostream &stream, state_t state) const
     }
 }
 
-std::vector<std::set<Fsm::state_t>> Fsm::epsilonClosures() const
+std::vector<std::vector<Fsm::Transition>> Fsm::reverseTransitions() const
 {
-    std::vector<std::set<state_t>> closures(m_transitions.size());
-    std::vector<bool> flags(m_transitions.size(), false);
-
-    for (state_t s = 0; s < m_transitions.size(); s++)
-    {
-        closures[s].insert(s);
-    }
+    std::vector<std::vector<Transition>> rt(m_transitions.size());
 
     for (state_t s = 0; s < m_transitions.size(); s++)
     {
-        buildEpsilonClosures(s, closures, flags);
+        for (const Transition &tr : m_transitions[s])
+        {
+            rt[tr.state].emplace_back(s, tr.first, tr.last);
+        }
     }
 
-    return closures;
+    return rt;
 }
 
-void Fsm::buildEpsilonClosures(
-    state_t state,
-    std::vector<std::set<state_t>> &closures,
-    std::vector<bool> &flags) const
+/// Computes epsilon closures with an iterative Tarjan pass over the epsilon
+/// edges. States of one strongly connected component share a closure, and
+/// components are completed in reverse topological order, so each closure is
+/// the union of its members and the already finished successor closures.
+/// Closures are sorted lists, so their size is that of their contents rather
+/// than the number of states.
+Fsm::EpsilonClosures Fsm::epsilonClosures() const
 {
-    if (flags[state])
+    static const std::size_t none = static_cast<std::size_t>(-1);
+
+    const std::size_t n = m_transitions.size();
+
+    EpsilonClosures ec;
+    ec.components.assign(n, none);
+    ec.offsets.push_back(0);
+
+    // marks[s] is the number of the last component whose closure took s.
+    std::vector<std::size_t> marks(n, none);
+    std::vector<state_t> closure;
+
+    std::vector<std::size_t> indices(n, none);
+    std::vector<std::size_t> lowlinks(n);
+    std::vector<state_t> stack;
+    std::vector<std::pair<state_t, std::size_t>> frames;
+
+    std::size_t counter = 0;
+
+    for (state_t root = 0; root < n; root++)
     {
-        return;
+        if (indices[root] != none)
+        {
+            continue;
+        }
+
+        indices[root] = lowlinks[root] = counter++;
+        stack.push_back(root);
+        frames.emplace_back(root, 0);
+
+        while (!frames.empty())
+        {
+            state_t v = frames.back().first;
+            const std::vector<Transition> &row = m_transitions[v];
+
+            state_t w = none;
+
+            while (frames.back().second < row.size())
+            {
+                const Transition &tr = row[frames.back().second++];
+
+                if (!tr.isEpsilon())
+                {
+                    continue;
+                }
+
+                if (indices[tr.state] == none)
+                {
+                    w = tr.state;
+                    break;
+                }
+
+                if (ec.components[tr.state] == none)
+                {
+                    lowlinks[v] = std::min(lowlinks[v], indices[tr.state]);
+                }
+            }
+
+            if (w != none)
+            {
+                indices[w] = lowlinks[w] = counter++;
+                stack.push_back(w);
+                frames.emplace_back(w, 0);
+                continue;
+            }
+
+            frames.pop_back();
+
+            if (!frames.empty())
+            {
+                state_t parent = frames.back().first;
+                lowlinks[parent] = std::min(lowlinks[parent], lowlinks[v]);
+            }
+
+            if (lowlinks[v] != indices[v])
+            {
+                continue;
+            }
+
+            const std::size_t component = ec.offsets.size() - 1;
+
+            auto members_begin = stack.end();
+
+            do
+            {
+                --members_begin;
+            } while (*members_begin != v);
+
+            for (auto it = members_begin; it != stack.end(); ++it)
+            {
+                ec.components[*it] = component;
+            }
+
+            closure.clear();
+
+            auto add = [&](state_t s) {
+                if (marks[s] != component)
+                {
+                    marks[s] = component;
+                    closure.push_back(s);
+                }
+            };
+
+            for (auto it = members_begin; it != stack.end(); ++it)
+            {
+                add(*it);
+
+                for (const Transition &tr : m_transitions[*it])
+                {
+                    if (tr.isEpsilon() &&
+                        ec.components[tr.state] != component)
+                    {
+                        for (state_t s : ec[tr.state])
+                        {
+                            add(s);
+                        }
+                    }
+                }
+            }
+
+            std::sort(closure.begin(), closure.end());
+            ec.states.insert(ec.states.end(), closure.begin(), closure.end());
+            ec.offsets.push_back(ec.states.size());
+
+            stack.erase(members_begin, stack.end());
+        }
     }
 
-    flags[state] = true;
+    return ec;
+}
 
-    for (state_t s = 0; s < m_transitions.size(); s++)
+/// Moves the states of @p fsm to the end of this automaton, shifting their
+/// transitions in place. Starting and final states are left to the caller.
+void Fsm::append(Fsm &&fsm)
+{
+    const state_t offset = m_transitions.size();
+
+    for (auto &row : fsm.m_transitions)
     {
-        if (m_transitions[state][s].find('\0') != m_transitions[state][s].end())
+        for (Transition &tr : row)
         {
-            buildEpsilonClosures(s, closures, flags);
-            closures[state].insert(closures[s].begin(), closures[s].end());
+            tr.state += offset;
         }
+
+        m_transitions.push_back(std::move(row));
     }
+
+    m_alphabet.insert(fsm.m_alphabet.begin(), fsm.m_alphabet.end());
 }
 
 ///@todo Refactor this
@@ -0,0 +1,282 @@
+#include "fsm/LazyDfa.hpp"
+#include <algorithm>
+#include <climits>
+#include <limits>
+#include "fsm/Fsm.hpp"
+
+namespace fsm {
+
+namespace {
+
+const LazyDfa::state_t c_unknown = std::numeric_limits<LazyDfa::state_t>::max();
+const std::size_t c_empty = static_cast<std::size_t>(-1);
+
+std::size_t hashSubset(const std::vector<LazyDfa::state_t> &subset)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+
+    for (LazyDfa::state_t s : subset)
+    {
+        hash = (hash ^ s) * 1099511628211ull;
+    }
+
+    return static_cast<std::size_t>(hash ^ (hash >> 32));
+}
+
+} // namespace
+
+constexpr std::size_t LazyDfa::default_cache_size;
+constexpr LazyDfa::state_t LazyDfa::dead_state;
+
+LazyDfa::LazyDfa(const Fsm &fsm, std::size_t cache_size)
+    : m_classes{fsm.getByteClasses()}
+    , m_stride{m_classes.size()}
+    , m_cache_size{cache_size}
+    , m_flush_count{0}
+    , m_starting_state{dead_state}
+    , m_generation{0}
+{
+    const auto &transitions = fsm.getTransitions();
+    const std::size_t states = transitions.size();
+
+    m_transitions.resize(states);
+    m_epsilon_transitions.resize(states);
+    m_final_states.assign(states, false);
+    m_marks.assign(states, 0);
+
+    for (std::size_t s = 0; s < states; s++)
+    {
+        for (const Fsm::Transition &tr : transitions[s])
+        {
+            if (!tr.isEpsilon())
+            {
+                m_transitions[s].push_back(
+                    {static_cast<unsigned char>(tr.first),
+                     static_cast<unsigned char>(tr.last),
+                     static_cast<state_t>(tr.state)});
+            }
+            else
+            {
+                m_epsilon_transitions[s].push_back(
+                    static_cast<state_t>(tr.state));
+            }
+        }
+    }
+
+    for (Fsm::state_t s : fsm.getFinalStates())
+    {
+        m_final_states[s] = true;
+    }
+
+    for (Fsm::state_t s : fsm.getStartingStates())
+    {
+        m_starting_states.push_back(static_cast<state_t>(s));
+    }
+
+    flush();
+    m_flush_count = 0;
+}
+
+LazyDfa::state_t LazyDfa::getStartingState() const
+{
+    return m_starting_state;
+}
+
+std::size_t LazyDfa::getFlushCount() const
+{
+    return m_flush_count;
+}
+
+LazyDfa::state_t LazyDfa::next(state_t state, char c)
+{
+    state_t next =
+        m_table[state + m_classes[static_cast<unsigned char>(c)]];
+    return next != c_unknown
+               ? next
+               : computeNext(state, static_cast<unsigned char>(c));
+}
+
+LazyDfa::state_t LazyDfa::run(state_t state, const char *begin, const char *end)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(begin);
+    const unsigned char *e = reinterpret_cast<const unsigned char *>(end);
+
+    for (; p != e; ++p)
+    {
+        state_t next = m_table[state + m_classes[*p]];
+        state = next != c_unknown ? next : computeNext(state, *p);
+    }
+
+    return state;
+}
+
+bool LazyDfa::match(const char *data, std::size_t size)
+{
+    return isFinal(run(m_starting_state, data, data + size));
+}
+
+LazyDfa::state_t LazyDfa::computeNext(state_t state, unsigned char c)
+{
+    const std::size_t index = state / m_stride;
+
+    m_scratch.clear();
+
+    for (std::size_t i = m_offsets[index]; i < m_offsets[index + 1]; i++)
+    {
+        for (const auto &tr : m_transitions[m_arena[i]])
+        {
+            if (c >= tr.first && c <= tr.last)
+            {
+                m_scratch.push_back(tr.state);
+            }
+        }
+    }
+
+    closeOver(m_scratch);
+
+    std::size_t state_size = (m_stride + m_scratch.size()) * sizeof(state_t);
+
+    if (getMemoryUsage() + state_size > m_cache_size)
+    {
+        flush();
+        return addState(m_scratch);
+    }
+
+    state_t next = addState(m_scratch);
+    m_table[state + m_classes[c]] = next;
+
+    return next;
+}
+
+LazyDfa::state_t LazyDfa::addState(const std::vector<state_t> &subset)
+{
+    std::size_t hash = hashSubset(subset);
+    std::size_t mask = m_buckets.size() - 1;
+
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        std::size_t index = m_buckets[i];
+
+        if (index == c_empty)
+        {
+            index = m_hashes.size();
+
+            m_buckets[i] = index;
+            m_hashes.push_back(hash);
+            m_arena.insert(m_arena.end(), subset.begin(), subset.end());
+            m_offsets.push_back(m_arena.size());
+
+            bool is_final = false;
+            for (state_t s : subset)
+            {
+                is_final = is_final || m_final_states[s];
+            }
+            m_final_flags.push_back(is_final);
+
+            m_table.resize(
+                m_table.size() + m_stride,
+                subset.empty() ? dead_state : c_unknown);
+
+            if (2 * m_hashes.size() > m_buckets.size())
+            {
+                rehash();
+            }
+
+            return static_cast<state_t>(index * m_stride);
+        }
+
+        if (m_hashes[index] == hash &&
+            m_offsets[index + 1] - m_offsets[index] == subset.size() &&
+            std::equal(
+                subset.begin(),
+                subset.end(),
+                m_arena.begin() + m_offsets[index]))
+        {
+            return static_cast<state_t>(index * m_stride);
+        }
+    }
+}
+
+void LazyDfa::closeOver(std::vector<state_t> &subset)
+{
+    if (++m_generation == 0)
+    {
+        std::fill(m_marks.begin(), m_marks.end(), 0);
+        m_generation = 1;
+    }
+
+    std::size_t size = 0;
+
+    for (state_t s : subset)
+    {
+        if (m_marks[s] != m_generation)
+        {
+            m_marks[s] = m_generation;
+            subset[size++] = s;
+        }
+    }
+
+    subset.resize(size);
+
+    for (std::size_t i = 0; i < subset.size(); i++)
+    {
+        for (state_t s : m_epsilon_transitions[subset[i]])
+        {
+            if (m_marks[s] != m_generation)
+            {
+                m_marks[s] = m_generation;
+                subset.push_back(s);
+            }
+        }
+    }
+
+    std::sort(subset.begin(), subset.end());
+}
+
+void LazyDfa::flush()
+{
+    m_table.clear();
+    m_final_flags.clear();
+    m_arena.clear();
+    m_offsets.assign(1, 0);
+    m_hashes.clear();
+    m_buckets.assign(16, c_empty);
+
+    m_flush_count++;
+
+    addState({});
+
+    std::vector<state_t> subset = m_starting_states;
+    closeOver(subset);
+    m_starting_state = addState(subset);
+}
+
+void LazyDfa::rehash()
+{
+    std::vector<std::size_t> buckets(m_buckets.size() * 2, c_empty);
+    std::size_t mask = buckets.size() - 1;
+
+    for (std::size_t index = 0; index < m_hashes.size(); index++)
+    {
+        std::size_t i = m_hashes[index] & mask;
+
+        while (buckets[i] != c_empty)
+        {
+            i = (i + 1) & mask;
+        }
+
+        buckets[i] = index;
+    }
+
+    m_buckets.swap(buckets);
+}
+
+std::size_t LazyDfa::getMemoryUsage() const
+{
+    return (m_table.size() + m_arena.size()) * sizeof(state_t) +
+           (m_offsets.size() + m_hashes.size() + m_buckets.size()) *
+               sizeof(std::size_t) +
+           m_final_flags.size() / CHAR_BIT;
+}
+
+} // namespace fsm
@@ -0,0 +1,95 @@
+#include "fsm/LiteralFinder.hpp"
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace fsm {
+
+LiteralFinder::LiteralFinder(const std::string &literal)
+    : m_literal{literal}
+{
+}
+
+const std::string &LiteralFinder::getLiteral() const
+{
+    return m_literal;
+}
+
+const char *LiteralFinder::find(const char *begin, const char *end) const
+{
+    const std::size_t size = m_literal.size();
+
+    if (size == 0)
+    {
+        return begin;
+    }
+
+    if (static_cast<std::size_t>(end - begin) < size)
+    {
+        return nullptr;
+    }
+
+    const char *literal = m_literal.data();
+    const char *last = end - size;
+
+    if (size == 1)
+    {
+        return static_cast<const char *>(
+            std::memchr(begin, literal[0], end - begin));
+    }
+
+    const char *p = begin;
+
+#if defined(__SSE2__)
+    const __m128i first_byte = _mm_set1_epi8(literal[0]);
+    const __m128i last_byte = _mm_set1_epi8(literal[size - 1]);
+
+    // Both loads of a block stay inside the buffer while p + 15 <= last.
+    for (; last - p >= 15; p += 16)
+    {
+        const __m128i firsts =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i lasts =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + size - 1));
+
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+            _mm_cmpeq_epi8(firsts, first_byte),
+            _mm_cmpeq_epi8(lasts, last_byte)));
+
+        while (mask)
+        {
+            const char *candidate = p + __builtin_ctz(mask);
+
+            if (std::memcmp(candidate + 1, literal + 1, size - 2) == 0)
+            {
+                return candidate;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    while (p <= last)
+    {
+        p = static_cast<const char *>(std::memchr(p, literal[0], last - p + 1));
+
+        if (!p)
+        {
+            return nullptr;
+        }
+
+        if (std::memcmp(p + 1, literal + 1, size - 1) == 0)
+        {
+            return p;
+        }
+
+        p++;
+    }
+
+    return nullptr;
+}
+
+} // namespace fsm
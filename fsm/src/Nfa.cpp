@@ -0,0 +1,353 @@
+#include "fsm/Nfa.hpp"
+#include <algorithm>
+#include <map>
+#include "fsm/Fsm.hpp"
+
+namespace fsm {
+
+namespace {
+
+const std::size_t c_max_positions = 256;
+const std::size_t c_chunk_bits = 8;
+const std::size_t c_chunk_values = 1 << c_chunk_bits;
+
+} // namespace
+
+Nfa::Nfa(const Fsm &fsm)
+    : m_words{0}
+{
+    const auto &transitions = fsm.getTransitions();
+    const std::size_t states = transitions.size();
+
+    m_transitions.resize(states);
+    m_epsilon_transitions.resize(states);
+    m_final_states.assign(states, false);
+
+    for (std::size_t s = 0; s < states; s++)
+    {
+        for (const Fsm::Transition &tr : transitions[s])
+        {
+            if (!tr.isEpsilon())
+            {
+                m_transitions[s].push_back(
+                    {static_cast<unsigned char>(tr.first),
+                     static_cast<unsigned char>(tr.last),
+                     tr.state});
+            }
+            else
+            {
+                m_epsilon_transitions[s].push_back(tr.state);
+            }
+        }
+    }
+
+    for (Fsm::state_t s : fsm.getFinalStates())
+    {
+        m_final_states[s] = true;
+    }
+
+    for (Fsm::state_t s : fsm.getStartingStates())
+    {
+        m_starting_states.push_back(s);
+    }
+
+    buildPositions();
+
+    if (!m_words)
+    {
+        m_current = SparseSet(states);
+        m_next = SparseSet(states);
+    }
+}
+
+bool Nfa::isBitParallel() const
+{
+    return m_words > 0;
+}
+
+bool Nfa::match(const char *data, std::size_t size)
+{
+    switch (m_words)
+    {
+    case 1:
+        return matchBitParallel<1>(data, size);
+
+    case 2:
+        return matchBitParallel<2>(data, size);
+
+    case 4:
+        return matchBitParallel<4>(data, size);
+
+    default:
+        return matchSparse(data, size);
+    }
+}
+
+/// Position 0 stands for the starting states. Every other position is a
+/// target state t together with the symbols of the edges from some source s
+/// to t; sources whose edges to t carry the same symbols share the position,
+/// so an epsilon-free automaton whose edges into a state are all labelled
+/// alike gets one position per state. Position q follows position p if the
+/// epsilon closure of p's target contains one of q's sources, so the
+/// positions reachable on a byte are Follow(active) & Symbols[byte].
+void Nfa::buildPositions()
+{
+    using Label = std::vector<std::pair<unsigned char, unsigned char>>;
+
+    const std::size_t states = m_transitions.size();
+
+    std::vector<std::size_t> targets{0};
+    std::vector<Label> labels(1);
+    std::vector<std::vector<std::size_t>> outgoing(states);
+    std::map<std::pair<std::size_t, Label>, std::size_t> indices;
+
+    for (std::size_t s = 0; s < states; s++)
+    {
+        const auto &row = m_transitions[s];
+
+        for (auto it = row.begin(); it != row.end();)
+        {
+            std::pair<std::size_t, Label> key{it->state, {}};
+
+            for (; it != row.end() && it->state == key.first; ++it)
+            {
+                key.second.emplace_back(it->first, it->last);
+            }
+
+            auto index = indices.find(key);
+
+            if (index == indices.end())
+            {
+                if (targets.size() == c_max_positions)
+                {
+                    return;
+                }
+
+                index = indices.emplace(std::move(key), targets.size()).first;
+                targets.push_back(index->first.first);
+                labels.push_back(index->first.second);
+            }
+
+            outgoing[s].push_back(index->second);
+        }
+    }
+
+    const std::size_t positions = targets.size();
+    m_words = positions <= 64 ? 1 : positions <= 128 ? 2 : 4;
+
+    const std::size_t chunks = m_words * 64 / c_chunk_bits;
+
+    std::vector<std::uint64_t> follow(positions * m_words, 0);
+    m_final_positions.assign(m_words, 0);
+
+    std::vector<bool> visited(states, false);
+    std::vector<std::size_t> closure;
+
+    for (std::size_t p = 0; p < positions; p++)
+    {
+        closure.clear();
+
+        if (p == 0)
+        {
+            closure = m_starting_states;
+        }
+        else
+        {
+            closure.push_back(targets[p]);
+        }
+
+        for (std::size_t s : closure)
+        {
+            visited[s] = true;
+        }
+
+        for (std::size_t i = 0; i < closure.size(); i++)
+        {
+            for (std::size_t t : m_epsilon_transitions[closure[i]])
+            {
+                if (!visited[t])
+                {
+                    visited[t] = true;
+                    closure.push_back(t);
+                }
+            }
+        }
+
+        for (std::size_t s : closure)
+        {
+            visited[s] = false;
+
+            if (m_final_states[s])
+            {
+                m_final_positions[p / 64] |= std::uint64_t{1} << (p % 64);
+            }
+
+            for (std::size_t q : outgoing[s])
+            {
+                follow[p * m_words + q / 64] |= std::uint64_t{1} << (q % 64);
+            }
+        }
+    }
+
+    m_symbols.assign(c_chunk_values * m_words, 0);
+
+    for (std::size_t p = 1; p < positions; p++)
+    {
+        for (const auto &range : labels[p])
+        {
+            for (std::size_t c = range.first; c <= range.second; c++)
+            {
+                m_symbols[c * m_words + p / 64] |= std::uint64_t{1}
+                                                   << (p % 64);
+            }
+        }
+    }
+
+    m_follow.assign(chunks * c_chunk_values * m_words, 0);
+
+    for (std::size_t chunk = 0; chunk < chunks; chunk++)
+    {
+        for (std::size_t value = 1; value < c_chunk_values; value++)
+        {
+            std::uint64_t *mask =
+                &m_follow[(chunk * c_chunk_values + value) * m_words];
+
+            for (std::size_t bit = 0; bit < c_chunk_bits; bit++)
+            {
+                std::size_t p = chunk * c_chunk_bits + bit;
+
+                if (p < positions && (value >> bit) & 1)
+                {
+                    for (std::size_t w = 0; w < m_words; w++)
+                    {
+                        mask[w] |= follow[p * m_words + w];
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <std::size_t W>
+bool Nfa::matchBitParallel(const char *data, std::size_t size) const
+{
+    static const std::size_t chunks = W * 64 / c_chunk_bits;
+
+    std::uint64_t current[W] = {1};
+
+    for (std::size_t i = 0; i < size; i++)
+    {
+        std::uint64_t next[W] = {};
+
+        for (std::size_t chunk = 0; chunk < chunks; chunk++)
+        {
+            std::size_t value =
+                (current[chunk / 8] >> (chunk % 8 * c_chunk_bits)) & 0xff;
+
+            if (value)
+            {
+                const std::uint64_t *mask =
+                    &m_follow[(chunk * c_chunk_values + value) * W];
+
+                for (std::size_t w = 0; w < W; w++)
+                {
+                    next[w] |= mask[w];
+                }
+            }
+        }
+
+        const std::uint64_t *symbols =
+            &m_symbols[static_cast<unsigned char>(data[i]) * W];
+
+        std::uint64_t any = 0;
+
+        for (std::size_t w = 0; w < W; w++)
+        {
+            current[w] = next[w] & symbols[w];
+            any |= current[w];
+        }
+
+        if (!any)
+        {
+            return false;
+        }
+    }
+
+    for (std::size_t w = 0; w < W; w++)
+    {
+        if (current[w] & m_final_positions[w])
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Nfa::matchSparse(const char *data, std::size_t size)
+{
+    m_current.clear();
+
+    for (std::size_t s : m_starting_states)
+    {
+        addClosure(m_current, s);
+    }
+
+    for (std::size_t i = 0; i < size && m_current.size(); i++)
+    {
+        m_next.clear();
+
+        for (std::size_t j = 0; j < m_current.size(); j++)
+        {
+            for (const auto &tr : m_transitions[m_current[j]])
+            {
+                auto c = static_cast<unsigned char>(data[i]);
+
+                if (c >= tr.first && c <= tr.last)
+                {
+                    addClosure(m_next, tr.state);
+                }
+            }
+        }
+
+        std::swap(m_current, m_next);
+    }
+
+    for (std::size_t j = 0; j < m_current.size(); j++)
+    {
+        if (m_final_states[m_current[j]])
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Nfa::addClosure(SparseSet &set, std::size_t state)
+{
+    if (set.contains(state))
+    {
+        return;
+    }
+
+    set.insert(state);
+    m_stack.push_back(state);
+
+    while (!m_stack.empty())
+    {
+        std::size_t s = m_stack.back();
+        m_stack.pop_back();
+
+        for (std::size_t t : m_epsilon_transitions[s])
+        {
+            if (!set.contains(t))
+            {
+                set.insert(t);
+                m_stack.push_back(t);
+            }
+        }
+    }
+}
+
+} // namespace fsm
@@ -1,10 +1,22 @@
 #include "fsm/Regex.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
+#include <iterator>
+#include <map>
 #include <stdexcept>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
+#include "fsm/Dfa.hpp"
 #include "fsm/Fsm.hpp"
+#include "fsm/LazyDfa.hpp"
+#include "fsm/LiteralFinder.hpp"
+#include "fsm/Nfa.hpp"
+#include "fsm/Stream.hpp"
+#include "fsm/TaggedNfa.hpp"
 
 namespace fsm {
 
@@ -46,465 +58,2285 @@ private:
     std::size_t m_indent;
 };
 
-class Node
+/// Builds the position automaton of a regex: one state per occurrence of a
+/// character, character set or wildcard, plus the starting state 0. Edges
+/// into a position are labelled with its symbols, so no epsilon edges are
+/// needed.
+class GlushkovBuilder final
 {
-public:
-    virtual ~Node()
-    {
-    }
-
-    virtual void print(NodePrintContext &ctx) = 0;
-    virtual Fsm compile() = 0;
-};
-
-using NodePtr = std::shared_ptr<Node>;
+public: // types
+    using Label = std::vector<std::pair<char, char>>;
 
-class CharacterNode : public Node
-{
-public:
-    explicit CharacterNode(char c)
-        : m_char{c}
+    /// Positions a subexpression can start and end with, and whether it
+    /// matches the empty string.
+    struct Fragment
     {
-    }
+        bool nullable;
+        std::vector<Fsm::state_t> first;
+        std::vector<Fsm::state_t> last;
+    };
 
-    void print(NodePrintContext &ctx) override
+public: // methods
+    /// Adds a position matching @p label on its own.
+    Fragment addPosition(const Label &label)
     {
-        ctx.print(
-            "CharacterNode { \"", m_char == '"' ? "\\" : "", m_char, "\" }\n");
-    }
+        m_labels.emplace_back(label);
 
-    Fsm compile() override
-    {
-        Fsm fsm(2);
-        fsm.setStarting(0);
-        fsm.setFinal(1);
-        fsm.connect(0, 1, m_char);
-        return fsm;
+        const Fsm::state_t p = m_labels.size();
+        return {false, {p}, {p}};
     }
 
-private:
-    char m_char;
-};
-
-class CharacterSetNode : public Node
-{
-public:
-    explicit CharacterSetNode(const std::vector<std::pair<char, char>> &sets)
-        : m_sets{sets}
+    Fragment concatenation(std::vector<Fragment> &&fragments)
     {
-    }
+        Fragment res{true, {}, {}};
 
-    void print(NodePrintContext &ctx) override
-    {
-        ctx.print("CharacterSetNode {\n");
-        ctx.indent();
-        for (const auto &set : m_sets)
+        for (Fragment &fragment : fragments)
         {
-            if (set.first != set.second)
+            follow(res.last, fragment.first);
+
+            if (res.nullable)
+            {
+                res.first.insert(
+                    res.first.end(),
+                    fragment.first.begin(),
+                    fragment.first.end());
+            }
+
+            if (fragment.nullable)
             {
-                ctx.print("Range { ", set.first, "-", set.second, " }\n");
+                res.last.insert(
+                    res.last.end(), fragment.last.begin(), fragment.last.end());
             }
             else
             {
-                ctx.print("Character { ", set.first, " }\n");
+                res.last = std::move(fragment.last);
             }
+
+            res.nullable = res.nullable && fragment.nullable;
         }
-        ctx.unindent();
-        ctx.print("}\n");
+
+        return res;
     }
 
-    Fsm compile() override
+    Fragment disjunction(std::vector<Fragment> &&fragments)
     {
-        Fsm fsm(2);
-        fsm.setStarting(0);
-        fsm.setFinal(1);
-        for (const auto &pair : m_sets)
+        Fragment res{false, {}, {}};
+
+        for (const Fragment &fragment : fragments)
         {
-            for (char c = pair.first; c <= pair.second; c++)
-            {
-                fsm.connect(0, 1, c);
-            }
+            res.nullable = res.nullable || fragment.nullable;
+            res.first.insert(
+                res.first.end(), fragment.first.begin(), fragment.first.end());
+            res.last.insert(
+                res.last.end(), fragment.last.begin(), fragment.last.end());
         }
-        return fsm;
-    }
-
-private:
-    std::vector<std::pair<char, char>> m_sets;
-};
-
-class WildcardNode : public Node
-{
-public:
-    void print(NodePrintContext &ctx) override
-    {
-        ctx.print("WildcardNode {}\n");
-    }
 
-    Fsm compile() override
-    {
-        return Fsm(0);
+        return res;
     }
-};
 
-class ConcatenationNode : public Node
-{
-public:
-    explicit ConcatenationNode(const std::vector<NodePtr> &nodes)
-        : m_nodes{nodes}
+    void iteration(const Fragment &fragment)
     {
+        follow(fragment.last, fragment.first);
     }
 
-    void print(NodePrintContext &ctx) override
+    /// Records that every position of @p to may follow every position of
+    /// @p from.
+    void follow(
+        const std::vector<Fsm::state_t> &from,
+        const std::vector<Fsm::state_t> &to)
     {
-        ctx.print("ConcatenationNode {\n");
-        ctx.indent();
-        for (const auto &node : m_nodes)
+        if (!from.empty() && !to.empty())
         {
-            node->print(ctx);
+            m_follows.emplace_back(from, to);
         }
-        ctx.unindent();
-        ctx.print("}\n");
     }
 
-    Fsm compile() override
+    Fsm build(const Fragment &root) const
     {
-        std::vector<Fsm> fsms;
-        for (const auto &node : m_nodes)
+        Fsm fsm(m_labels.size() + 1);
+        fsm.setStarting(0);
+
+        if (root.nullable)
         {
-            fsms.emplace_back(node->compile());
+            fsm.setFinal(0);
         }
-        return Fsm::concatenation(fsms);
-    }
 
-private:
-    std::vector<NodePtr> m_nodes;
-};
+        for (Fsm::state_t p : root.last)
+        {
+            fsm.setFinal(p);
+        }
 
-class GroupNode : public Node
-{
-public:
-    explicit GroupNode(const std::vector<NodePtr> &nodes)
-        : m_nodes{nodes}
-    {
-    }
+        connect(fsm, {0}, root.first);
 
-    void print(NodePrintContext &ctx) override
-    {
-        ctx.print("GroupNode {\n");
-        ctx.indent();
-        for (const auto &node : m_nodes)
+        for (const auto &follow : m_follows)
         {
-            node->print(ctx);
+            connect(fsm, follow.first, follow.second);
         }
-        ctx.unindent();
-        ctx.print("}\n");
+
+        return fsm;
     }
 
-    Fsm compile() override
+private: // methods
+    void connect(
+        Fsm &fsm,
+        const std::vector<Fsm::state_t> &from,
+        const std::vector<Fsm::state_t> &to) const
     {
-        std::vector<Fsm> fsms;
-        for (const auto &node : m_nodes)
+        for (Fsm::state_t p : to)
         {
-            fsms.emplace_back(node->compile());
+            for (const auto &range : m_labels[p - 1])
+            {
+                for (Fsm::state_t q : from)
+                {
+                    fsm.connect(q, p, range.first, range.second);
+                }
+            }
         }
-        return Fsm::disjunction(fsms);
     }
 
-private:
-    std::vector<NodePtr> m_nodes;
+private: // fields
+    std::vector<Label> m_labels;
+    std::vector<
+        std::pair<std::vector<Fsm::state_t>, std::vector<Fsm::state_t>>>
+        m_follows;
 };
 
-class IterationNode : public Node
+/// Builds the position automaton like GlushkovBuilder, but the edges carry
+/// tags: capture g records its start in tag 2g on the edges that enter it,
+/// and its end in tag 2g + 1 on the edges that leave it.
+///
+/// Every position keeps the entries it is followed by in order of priority.
+/// Entry 0 there, or in the first entries of a fragment, stands for leaving
+/// the subexpression without reading more of it, and the construct around
+/// replaces it in place with the entries that come next. An empty path thus
+/// keeps its priority among the alternatives, the loop of an iteration goes
+/// before leaving it, and iterations are greedy.
+class TaggedGlushkovBuilder final
 {
-public:
-    explicit IterationNode(NodePtr node)
-        : m_node{node}
-    {
-    }
+public: // types
+    using Tags = std::vector<TaggedNfa::tag_t>;
 
-    void print(NodePrintContext &ctx) override
+    /// Position, or 0 for the way out, and the tags recorded on the way.
+    struct Entry
     {
-        ctx.print("IterationNode {\n");
-        ctx.indent();
-        m_node->print(ctx);
-        ctx.unindent();
-        ctx.print("}\n");
-    }
+        TaggedNfa::state_t position;
+        Tags tags;
+    };
 
-    Fsm compile() override
+    /// Entries a subexpression starts with, 0 among them if it matches the
+    /// empty string, and the positions whose way out leaves it.
+    struct Fragment
     {
-        return Fsm::iteration(m_node->compile());
-    }
+        std::vector<Entry> first;
+        std::vector<TaggedNfa::state_t> last;
+    };
 
-private:
-    NodePtr m_node;
-};
-
-class OptionalNode : public Node
-{
-public:
-    explicit OptionalNode(NodePtr node)
-        : m_node{node}
+public: // methods
+    TaggedGlushkovBuilder()
+        : m_follows(1)
+        , m_added(1, false)
     {
     }
 
-    void print(NodePrintContext &ctx) override
+    Fragment addPosition(const GlushkovBuilder::Label &label)
     {
-        ctx.print("OptionalNode {\n");
-        ctx.indent();
-        m_node->print(ctx);
-        ctx.unindent();
-        ctx.print("}\n");
-    }
+        m_labels.emplace_back(label);
+        m_follows.push_back({{0, {}}});
+        m_added.push_back(false);
 
-    Fsm compile() override
-    {
-        return Fsm::option(m_node->compile());
+        const TaggedNfa::state_t p = m_labels.size();
+        return {{{p, {}}}, {p}};
     }
 
-private:
-    NodePtr m_node;
-};
-
-class RegexParser final
-{
-public: // methods
-    NodePtr parse(const std::string &pattern)
+    Fragment concatenation(std::vector<Fragment> &&fragments)
     {
-        m_pattern = pattern;
-        m_pos = 0;
+        Fragment res{{{0, {}}}, {}};
 
-        getChar();
+        for (Fragment &fragment : fragments)
+        {
+            for (TaggedNfa::state_t q : res.last)
+            {
+                splice(m_follows[q], fragment.first);
+            }
 
-        NodePtr node = expr();
+            splice(res.first, fragment.first);
 
-        if (!check('\0'))
-        {
-            throw std::runtime_error(
-                "unexpected character '" + std::string(1, std::abs(m_char)) +
-                "'");
+            if (!isNullable(fragment))
+            {
+                res.last.clear();
+            }
+
+            res.last.insert(
+                res.last.end(), fragment.last.begin(), fragment.last.end());
         }
 
-        return node;
+        return res;
     }
 
-private: // methods
-    void getChar()
+    /// Earlier alternatives take priority.
+    Fragment disjunction(std::vector<Fragment> &&fragments)
     {
-        static const std::string opeators("+*?.|()[]");
+        Fragment res;
 
-        if (m_pos >= m_pattern.size())
-        {
-            m_char = '\0';
-        }
-        else if (m_pattern[m_pos] == '\\')
+        for (Fragment &fragment : fragments)
         {
-            if (++m_pos >= m_pattern.size())
+            for (Entry &entry : fragment.first)
             {
-                throw std::runtime_error("invalid escape sequence");
+                add(res.first, std::move(entry));
             }
 
-            m_char = m_pattern[m_pos++];
-        }
-        else if (opeators.find(m_pattern[m_pos]) != std::string::npos)
-        {
-            m_char = -m_pattern[m_pos++];
-        }
-        else
-        {
-            m_char = m_pattern[m_pos++];
+            res.last.insert(
+                res.last.end(), fragment.last.begin(), fragment.last.end());
         }
+
+        clearAdded(res.first);
+        return res;
     }
 
-    bool accept(char c)
+    /// Another round may match the empty string, but the loop stops then.
+    void iteration(const Fragment &fragment)
     {
-        if (check(c))
+        std::vector<Entry> next(fragment.first);
+        next.push_back({0, {}});
+
+        for (TaggedNfa::state_t q : fragment.last)
         {
-            getChar();
-            return true;
+            splice(m_follows[q], next);
         }
-
-        return false;
-    }
-
-    bool check(char c)
-    {
-        return m_char == -c;
     }
 
-    NodePtr expr()
+    void option(Fragment &fragment)
     {
-        std::vector<NodePtr> nodes;
-
-        while (!check('\0') && !check('|') && !check(')'))
+        if (!isNullable(fragment))
         {
-            nodes.emplace_back(suffix());
+            fragment.first.push_back({0, {}});
         }
-
-        return nodes.size() == 1 ? nodes[0]
-                                 : NodePtr{new ConcatenationNode(nodes)};
     }
 
-    NodePtr suffix()
+    void capture(Fragment &fragment, TaggedNfa::tag_t group)
     {
-        NodePtr node = term();
+        const TaggedNfa::tag_t start = 2 * group;
+        const TaggedNfa::tag_t end = start + 1;
 
-        while (true)
+        for (Entry &entry : fragment.first)
         {
-            if (accept('+'))
-            {
-                node.reset(new IterationNode(node));
-            }
-            else if (accept('*'))
-            {
-                node.reset(new OptionalNode(NodePtr{new IterationNode(node)}));
-            }
-            else if (accept('?'))
+            entry.tags.insert(entry.tags.begin(), start);
+
+            if (entry.position == 0)
             {
-                node.reset(new OptionalNode(node));
+                entry.tags.push_back(end);
             }
-            else
+        }
+
+        for (TaggedNfa::state_t q : fragment.last)
+        {
+            for (Entry &entry : m_follows[q])
             {
-                break;
+                if (entry.position == 0)
+                {
+                    entry.tags.push_back(end);
+                }
             }
         }
-
-        return node;
     }
 
-    NodePtr term()
+    TaggedNfa build(const Fragment &root, std::size_t groups) const
     {
-        NodePtr node = nullptr;
+        std::vector<TaggedNfa::State> states(m_labels.size() + 1);
 
-        if (accept('.'))
+        for (TaggedNfa::state_t s = 0; s < states.size(); s++)
         {
-            node.reset(new WildcardNode);
-        }
-        else if (accept('('))
-        {
-            std::vector<NodePtr> nodes;
+            const std::vector<Entry> &follows = s ? m_follows[s] : root.first;
 
-            if (!accept(')'))
+            for (const Entry &entry : follows)
             {
-                do
+                if (entry.position == 0)
                 {
-                    nodes.emplace_back(expr());
-                } while (accept('|'));
+                    states[s].final = true;
+                    states[s].final_tags = entry.tags;
+                    continue;
+                }
 
-                if (!accept(')'))
+                for (const auto &range : m_labels[entry.position - 1])
                 {
-                    throw std::runtime_error("unmatched parentheses");
+                    states[s].transitions.push_back(
+                        {entry.position,
+                         range.first,
+                         range.second,
+                         entry.tags});
                 }
             }
+        }
 
-            if (nodes.size() == 1)
-            {
-                node = nodes[0];
-            }
-            else
+        return TaggedNfa(states, 2 * groups);
+    }
+
+private: // methods
+    static bool isNullable(const Fragment &fragment)
+    {
+        for (const Entry &entry : fragment.first)
+        {
+            if (entry.position == 0)
             {
-                node.reset(new GroupNode(nodes));
+                return true;
             }
         }
-        else if (accept('['))
-        {
-            std::vector<std::pair<char, char>> sets;
-
-            while (m_pos < m_pattern.size() && !check(']'))
-            {
-                if (m_char == '-' && m_pattern[m_pos - 2] != '\\')
-                {
-                    throw std::runtime_error("invalid character set");
-                }
-
-                char first = std::abs(m_char);
-                getChar();
-
-                char second;
-
-                if (m_char == '-' && m_pattern[m_pos - 2] != '\\')
-                {
-                    getChar();
 
-                    if (check(']') && m_pattern[m_pos - 2] != '\\')
-                    {
-                        throw std::runtime_error("invalid character set");
-                    }
+        return false;
+    }
 
-                    second = std::abs(m_char);
-                    getChar();
-                }
-                else
-                {
-                    second = first;
-                }
+    static Tags join(const Tags &a, const Tags &b)
+    {
+        Tags res(a);
+        res.insert(res.end(), b.begin(), b.end());
+        return res;
+    }
 
-                if (second < first)
-                {
-                    throw std::runtime_error("invalid character set");
-                }
+    /// Replaces the way out of @p entries with @p next, recording its tags
+    /// before theirs.
+    void splice(std::vector<Entry> &entries, const std::vector<Entry> &next)
+    {
+        std::vector<Entry> res;
 
-                sets.emplace_back(std::make_pair(first, second));
+        for (Entry &entry : entries)
+        {
+            if (entry.position != 0)
+            {
+                add(res, std::move(entry));
+                continue;
             }
 
-            if (!accept(']'))
+            for (const Entry &follow : next)
             {
-                throw std::runtime_error("unmatched brackets");
+                add(res, {follow.position, join(entry.tags, follow.tags)});
             }
-
-            node.reset(new CharacterSetNode(sets));
         }
-        else if (m_char < 0 && !check('|') && !check(')'))
+
+        clearAdded(res);
+        entries = std::move(res);
+    }
+
+    /// Skips an entry to a position that @p entries already reach, because
+    /// the earlier one always takes priority.
+    void add(std::vector<Entry> &entries, Entry &&entry)
+    {
+        if (!m_added[entry.position])
         {
-            throw std::runtime_error(
-                "unexpected character '" + std::string(1, -m_char) + "'");
+            m_added[entry.position] = true;
+            entries.push_back(std::move(entry));
         }
-        else
+    }
+
+    void clearAdded(const std::vector<Entry> &entries)
+    {
+        for (const Entry &entry : entries)
         {
-            node.reset(new CharacterNode(m_char));
-            getChar();
+            m_added[entry.position] = false;
         }
-
-        return node;
     }
 
 private: // fields
-    std::string m_pattern;
-    std::size_t m_pos;
-    char m_char;
+    std::vector<GlushkovBuilder::Label> m_labels;
+    std::vector<std::vector<Entry>> m_follows;
+    std::vector<bool> m_added;
 };
 
-class RegexImpl final
+/// Syntax tree of a regex. The nodes live in one array and refer to their
+/// children by index, and a node is always added after its children. The
+/// passes over the tree walk it with an explicit stack instead of recursing.
+/// Identical subtrees may be shared, which makes the tree a DAG.
+class Ast final
 {
+public: // types
+    using index_t = std::uint32_t;
+
+    enum class Type
+    {
+        Character,
+        CharacterSet,
+        Wildcard,
+        Concatenation,
+        Group,
+        Iteration,
+        Optional,
+        Capture,
+    };
+
+    /// [begin, end) indexes the children of an operator, or the ranges of a
+    /// character set.
+    struct Node
+    {
+        Type type;
+        char symbol;
+        index_t begin;
+        index_t end;
+    };
+
 public: // methods
-    RegexImpl(const std::string &pattern)
-        : m_fsm{Regex::buildFsm(pattern).min()}
+    Ast()
+        : m_root{0}
     {
     }
 
-    bool match(const std::string &str)
+    std::size_t size() const
     {
-        ///@todo Implement
-        return false;
+        return m_nodes.size();
     }
 
-private: // fields
-    Fsm m_fsm;
-};
+    const Node &operator[](index_t index) const
+    {
+        return m_nodes[index];
+    }
 
-Regex::Regex(const std::string &pattern)
-    : m_impl{new RegexImpl{pattern}}
-{
-}
+    index_t getRoot() const
+    {
+        return m_root;
+    }
 
-bool Regex::match(const std::string &str)
-{
-    return m_impl->match(str);
+    void setRoot(index_t root)
+    {
+        m_root = root;
+    }
+
+    const index_t *getChildren(const Node &node) const
+    {
+        return m_children.data() + node.begin;
+    }
+
+    const std::pair<char, char> *getRanges(const Node &node) const
+    {
+        return m_ranges.data() + node.begin;
+    }
+
+    index_t addCharacter(char c)
+    {
+        return add({Type::Character, c, 0, 0});
+    }
+
+    index_t addCharacterSet(const std::vector<std::pair<char, char>> &ranges)
+    {
+        index_t begin = m_ranges.size();
+        m_ranges.insert(m_ranges.end(), ranges.begin(), ranges.end());
+        return add(
+            {Type::CharacterSet,
+             '\0',
+             begin,
+             static_cast<index_t>(m_ranges.size())});
+    }
+
+    index_t addWildcard()
+    {
+        return add({Type::Wildcard, '\0', 0, 0});
+    }
+
+    index_t addOperator(Type type, const index_t *children, std::size_t count)
+    {
+        index_t begin = m_children.size();
+        m_children.insert(m_children.end(), children, children + count);
+        return add(
+            {type, '\0', begin, static_cast<index_t>(m_children.size())});
+    }
+
+    void print(std::ostream &stream) const
+    {
+        NodePrintContext ctx(stream);
+
+        // A negative entry closes the node with the complemented index.
+        std::vector<std::int64_t> stack{m_root};
+
+        while (!stack.empty())
+        {
+            std::int64_t entry = stack.back();
+            stack.pop_back();
+
+            if (entry < 0)
+            {
+                ctx.unindent();
+                ctx.print("}\n");
+                continue;
+            }
+
+            const Node &node = m_nodes[entry];
+
+            switch (node.type)
+            {
+            case Type::Character:
+                ctx.print(
+                    "CharacterNode { \"",
+                    node.symbol == '"' ? "\\" : "",
+                    node.symbol,
+                    "\" }\n");
+                continue;
+
+            case Type::CharacterSet:
+                ctx.print("CharacterSetNode {\n");
+                ctx.indent();
+                for (index_t i = node.begin; i < node.end; i++)
+                {
+                    const auto &set = m_ranges[i];
+                    if (set.first != set.second)
+                    {
+                        ctx.print(
+                            "Range { ", set.first, "-", set.second, " }\n");
+                    }
+                    else
+                    {
+                        ctx.print("Character { ", set.first, " }\n");
+                    }
+                }
+                ctx.unindent();
+                ctx.print("}\n");
+                continue;
+
+            case Type::Wildcard:
+                ctx.print("WildcardNode {}\n");
+                continue;
+
+            case Type::Concatenation:
+                ctx.print("ConcatenationNode {\n");
+                break;
+
+            case Type::Group:
+                ctx.print("GroupNode {\n");
+                break;
+
+            case Type::Iteration:
+                ctx.print("IterationNode {\n");
+                break;
+
+            case Type::Optional:
+                ctx.print("OptionalNode {\n");
+                break;
+
+            case Type::Capture:
+                ctx.print("CaptureNode {\n");
+                break;
+            }
+
+            ctx.indent();
+            stack.push_back(~entry);
+
+            for (index_t i = node.end; i > node.begin; i--)
+            {
+                stack.push_back(m_children[i - 1]);
+            }
+        }
+    }
+
+    /// Longest string that every match contains, found from the exact
+    /// strings, prefixes and suffixes of the subexpressions.
+    std::string getRequiredLiteral() const
+    {
+        std::vector<Literals> literals;
+        literals.reserve(m_nodes.size());
+
+        for (const Node &node : m_nodes)
+        {
+            const index_t *children = getChildren(node);
+            Literals res{false, {}, {}, {}};
+
+            switch (node.type)
+            {
+            case Type::Character:
+                res = {true, std::string(1, node.symbol), {}, {}};
+                break;
+
+            case Type::CharacterSet:
+            case Type::Wildcard:
+            case Type::Optional:
+                break;
+
+            case Type::Concatenation:
+                res.exact = true;
+
+                for (std::size_t i = 0; i < count(node); i++)
+                {
+                    res.append(literals[children[i]]);
+                }
+
+                res.keepLonger(res.suffix);
+                break;
+
+            case Type::Group:
+                if (count(node) == 1)
+                {
+                    res = literals[*children];
+                    break;
+                }
+
+                for (std::size_t i = 0; i < count(node); i++)
+                {
+                    const Literals &alternative = literals[children[i]];
+
+                    if (i == 0)
+                    {
+                        res.prefix = alternative.prefix;
+                        res.suffix = alternative.getSuffix();
+                    }
+                    else
+                    {
+                        res.keepCommonPrefix(alternative.prefix);
+                        res.keepCommonSuffix(alternative.getSuffix());
+                    }
+                }
+
+                res.keepLonger(res.prefix);
+                res.keepLonger(res.suffix);
+                break;
+
+            case Type::Iteration:
+            {
+                const Literals &operand = literals[*children];
+                res = {false,
+                       operand.prefix,
+                       operand.getSuffix(),
+                       operand.getFactor()};
+                break;
+            }
+
+            case Type::Capture:
+                res = literals[*children];
+                break;
+            }
+
+            literals.emplace_back(std::move(res));
+        }
+
+        return literals[m_root].getFactor();
+    }
+
+    /// Thompson construction.
+    Fsm compile() const
+    {
+        std::vector<Fsm> stack;
+
+        walk([&](const Node &node) {
+            switch (node.type)
+            {
+            case Type::Character:
+                stack.emplace_back(atom());
+                stack.back().connect(0, 1, node.symbol);
+                break;
+
+            case Type::CharacterSet:
+                stack.emplace_back(atom());
+                for (index_t i = node.begin; i < node.end; i++)
+                {
+                    stack.back().connect(
+                        0, 1, m_ranges[i].first, m_ranges[i].second);
+                }
+                break;
+
+            case Type::Wildcard:
+                stack.emplace_back(atom());
+                stack.back().connect(0, 1, '\x01', '\xff');
+                break;
+
+            case Type::Concatenation:
+                stack.emplace_back(
+                    Fsm::concatenation(pop(stack, count(node))));
+                break;
+
+            case Type::Group:
+                stack.emplace_back(Fsm::disjunction(pop(stack, count(node))));
+                break;
+
+            case Type::Iteration:
+                stack.back() = Fsm::iteration(std::move(stack.back()));
+                break;
+
+            case Type::Optional:
+                stack.back() = Fsm::option(std::move(stack.back()));
+                break;
+
+            case Type::Capture:
+                break;
+            }
+        });
+
+        return std::move(stack.back());
+    }
+
+    /// Glushkov construction.
+    Fsm glushkov() const
+    {
+        GlushkovBuilder builder;
+        std::vector<GlushkovBuilder::Fragment> stack;
+
+        walk([&](const Node &node) {
+            switch (node.type)
+            {
+            case Type::Character:
+                stack.emplace_back(
+                    builder.addPosition({{node.symbol, node.symbol}}));
+                break;
+
+            case Type::CharacterSet:
+                stack.emplace_back(builder.addPosition(GlushkovBuilder::Label(
+                    getRanges(node), getRanges(node) + count(node))));
+                break;
+
+            case Type::Wildcard:
+                stack.emplace_back(builder.addPosition({{'\x01', '\xff'}}));
+                break;
+
+            case Type::Concatenation:
+                stack.emplace_back(
+                    builder.concatenation(pop(stack, count(node))));
+                break;
+
+            case Type::Group:
+                stack.emplace_back(
+                    builder.disjunction(pop(stack, count(node))));
+                break;
+
+            case Type::Iteration:
+                builder.iteration(stack.back());
+                break;
+
+            case Type::Optional:
+                stack.back().nullable = true;
+                break;
+
+            case Type::Capture:
+                break;
+            }
+        });
+
+        return builder.build(stack.back());
+    }
+
+    /// Glushkov construction with tags recording the bounds of the captures.
+    /// Capture 0 spans the whole match, and the others are numbered by their
+    /// opening parentheses, i.e. in preorder.
+    TaggedNfa tagged() const
+    {
+        std::vector<TaggedNfa::tag_t> groups(m_nodes.size());
+        TaggedNfa::tag_t group_count = 1;
+
+        std::vector<index_t> preorder{m_root};
+
+        while (!preorder.empty())
+        {
+            const index_t index = preorder.back();
+            const Node &node = m_nodes[index];
+            preorder.pop_back();
+
+            if (node.type == Type::Capture)
+            {
+                groups[index] = group_count++;
+            }
+
+            if (hasChildren(node.type))
+            {
+                for (index_t i = node.end; i > node.begin; i--)
+                {
+                    preorder.push_back(m_children[i - 1]);
+                }
+            }
+        }
+
+        TaggedGlushkovBuilder builder;
+        std::vector<TaggedGlushkovBuilder::Fragment> stack;
+
+        walk([&](const Node &node) {
+            switch (node.type)
+            {
+            case Type::Character:
+                stack.emplace_back(
+                    builder.addPosition({{node.symbol, node.symbol}}));
+                break;
+
+            case Type::CharacterSet:
+                stack.emplace_back(builder.addPosition(GlushkovBuilder::Label(
+                    getRanges(node), getRanges(node) + count(node))));
+                break;
+
+            case Type::Wildcard:
+                stack.emplace_back(builder.addPosition({{'\x01', '\xff'}}));
+                break;
+
+            case Type::Concatenation:
+                stack.emplace_back(
+                    builder.concatenation(pop(stack, count(node))));
+                break;
+
+            case Type::Group:
+                stack.emplace_back(
+                    builder.disjunction(pop(stack, count(node))));
+                break;
+
+            case Type::Iteration:
+                builder.iteration(stack.back());
+                break;
+
+            case Type::Optional:
+                builder.option(stack.back());
+                break;
+
+            case Type::Capture:
+                builder.capture(stack.back(), groups[&node - m_nodes.data()]);
+                break;
+            }
+        });
+
+        builder.capture(stack.back(), 0);
+
+        return builder.build(stack.back(), group_count);
+    }
+
+private: // types
+    /// Strings every match of a subexpression starts with, ends with and
+    /// contains. An exact subexpression matches only its prefix, and its
+    /// suffix and factor are left empty.
+    struct Literals
+    {
+        bool exact;
+        std::string prefix;
+        std::string suffix;
+        std::string factor;
+
+        const std::string &getSuffix() const
+        {
+            return exact ? prefix : suffix;
+        }
+
+        const std::string &getFactor() const
+        {
+            return exact ? prefix : factor;
+        }
+
+        void keepLonger(const std::string &candidate)
+        {
+            if (!exact && candidate.size() > factor.size())
+            {
+                factor = candidate;
+            }
+        }
+
+        void keepCommonPrefix(const std::string &other)
+        {
+            std::size_t n = 0;
+
+            while (n < prefix.size() && n < other.size() &&
+                   prefix[n] == other[n])
+            {
+                n++;
+            }
+
+            prefix.resize(n);
+        }
+
+        void keepCommonSuffix(const std::string &other)
+        {
+            std::size_t n = 0;
+
+            while (n < suffix.size() && n < other.size() &&
+                   suffix[suffix.size() - n - 1] == other[other.size() - n - 1])
+            {
+                n++;
+            }
+
+            suffix.erase(0, suffix.size() - n);
+        }
+
+        /// Extends the literals of a concatenation by one more operand.
+        void append(const Literals &next)
+        {
+            if (next.exact)
+            {
+                (exact ? prefix : suffix) += next.prefix;
+                return;
+            }
+
+            std::string joint = getSuffix() + next.prefix;
+
+            if (exact)
+            {
+                exact = false;
+                prefix = joint;
+            }
+
+            keepLonger(joint);
+            keepLonger(next.factor);
+            suffix = next.suffix;
+        }
+    };
+
+private: // methods
+    index_t add(const Node &node)
+    {
+        m_nodes.push_back(node);
+        return m_nodes.size() - 1;
+    }
+
+    static std::size_t count(const Node &node)
+    {
+        return node.end - node.begin;
+    }
+
+    static Fsm atom()
+    {
+        Fsm fsm(2);
+        fsm.setStarting(0);
+        fsm.setFinal(1);
+        return fsm;
+    }
+
+    static bool hasChildren(Type type)
+    {
+        return type != Type::Character && type != Type::CharacterSet &&
+               type != Type::Wildcard;
+    }
+
+    /// Calls @p visit on every occurrence of a node under the root, children
+    /// first. A subtree shared by several parents is visited once per parent.
+    template <class Visit>
+    void walk(Visit visit) const
+    {
+        // A negative entry visits the node with the complemented index.
+        std::vector<std::int64_t> stack{m_root};
+
+        while (!stack.empty())
+        {
+            std::int64_t entry = stack.back();
+            stack.pop_back();
+
+            if (entry < 0)
+            {
+                visit(m_nodes[~entry]);
+                continue;
+            }
+
+            const Node &node = m_nodes[entry];
+            stack.push_back(~entry);
+
+            if (hasChildren(node.type))
+            {
+                for (index_t i = node.end; i > node.begin; i--)
+                {
+                    stack.push_back(m_children[i - 1]);
+                }
+            }
+        }
+    }
+
+    /// Removes the top @p count values of @p stack and returns them in order.
+    template <class T>
+    static std::vector<T> pop(std::vector<T> &stack, std::size_t count)
+    {
+        auto begin = stack.end() - count;
+
+        std::vector<T> res(
+            std::make_move_iterator(begin),
+            std::make_move_iterator(stack.end()));
+        stack.erase(begin, stack.end());
+
+        return res;
+    }
+
+private: // fields
+    std::vector<Node> m_nodes;
+    std::vector<index_t> m_children;
+    std::vector<std::pair<char, char>> m_ranges;
+    index_t m_root;
+};
+
+class RegexParser final
+{
+public: // methods
+    /// Keeps the operands and the open parentheses on explicit stacks rather
+    /// than recursing, so nesting is limited by memory only. With
+    /// @p captures, every parenthesised subexpression is wrapped in a
+    /// capture node.
+    Ast parse(const std::string &pattern, bool captures = false)
+    {
+        m_pattern = pattern;
+        m_captures = captures;
+        m_pos = 0;
+        m_ast = Ast();
+        m_operands.clear();
+        m_groups.clear();
+
+        getChar();
+
+        while (true)
+        {
+            if (!check('\0') && !check('|') && !check(')'))
+            {
+                if (term())
+                {
+                    suffix();
+                }
+
+                continue;
+            }
+
+            if (m_groups.empty())
+            {
+                break;
+            }
+
+            if (check('\0'))
+            {
+                throw std::runtime_error("unmatched parentheses");
+            }
+
+            Group &group = m_groups.back();
+            reduce(Ast::Type::Concatenation, group.items);
+
+            if (accept('|'))
+            {
+                group.items = m_operands.size();
+                continue;
+            }
+
+            getChar();
+
+            std::size_t alternatives = group.alternatives;
+            m_groups.pop_back();
+
+            if (m_operands.size() - alternatives > 1)
+            {
+                reduce(Ast::Type::Group, alternatives);
+            }
+
+            capture();
+            suffix();
+        }
+
+        if (!check('\0'))
+        {
+            throw std::runtime_error(
+                "unexpected character '" + std::string(1, std::abs(m_char)) +
+                "'");
+        }
+
+        reduce(Ast::Type::Concatenation, 0);
+        m_ast.setRoot(m_operands.back());
+
+        return std::move(m_ast);
+    }
+
+private: // types
+    /// Open parenthesis: where its alternatives and the operands of the
+    /// current alternative start on the operand stack.
+    struct Group
+    {
+        std::size_t alternatives;
+        std::size_t items;
+    };
+
+private: // methods
+    void getChar()
+    {
+        static const std::string opeators("+*?.|()[]");
+
+        if (m_pos >= m_pattern.size())
+        {
+            m_char = '\0';
+        }
+        else if (m_pattern[m_pos] == '\\')
+        {
+            if (++m_pos >= m_pattern.size())
+            {
+                throw std::runtime_error("invalid escape sequence");
+            }
+
+            m_char = m_pattern[m_pos++];
+        }
+        else if (opeators.find(m_pattern[m_pos]) != std::string::npos)
+        {
+            m_char = -m_pattern[m_pos++];
+        }
+        else
+        {
+            m_char = m_pattern[m_pos++];
+        }
+    }
+
+    bool accept(char c)
+    {
+        if (check(c))
+        {
+            getChar();
+            return true;
+        }
+
+        return false;
+    }
+
+    bool check(char c)
+    {
+        return m_char == -c;
+    }
+
+    /// Replaces the operands from @p begin to the top of the stack with one
+    /// node of the given type, unless there is exactly one of them.
+    void reduce(Ast::Type type, std::size_t begin)
+    {
+        std::size_t count = m_operands.size() - begin;
+
+        if (count == 1)
+        {
+            return;
+        }
+
+        Ast::index_t node =
+            m_ast.addOperator(type, m_operands.data() + begin, count);
+
+        m_operands.resize(begin);
+        m_operands.push_back(node);
+    }
+
+    /// Wraps the operand of a closed parenthesis in a capture, if enabled.
+    void capture()
+    {
+        if (m_captures)
+        {
+            Ast::index_t &node = m_operands.back();
+            node = m_ast.addOperator(Ast::Type::Capture, &node, 1);
+        }
+    }
+
+    void suffix()
+    {
+        Ast::index_t &node = m_operands.back();
+
+        while (true)
+        {
+            if (accept('+'))
+            {
+                node = m_ast.addOperator(Ast::Type::Iteration, &node, 1);
+            }
+            else if (accept('*'))
+            {
+                node = m_ast.addOperator(Ast::Type::Iteration, &node, 1);
+                node = m_ast.addOperator(Ast::Type::Optional, &node, 1);
+            }
+            else if (accept('?'))
+            {
+                node = m_ast.addOperator(Ast::Type::Optional, &node, 1);
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    /// Pushes the next operand, or opens a parenthesis and returns false.
+    bool term()
+    {
+        if (accept('.'))
+        {
+            m_operands.push_back(m_ast.addWildcard());
+        }
+        else if (accept('('))
+        {
+            if (!accept(')'))
+            {
+                m_groups.push_back({m_operands.size(), m_operands.size()});
+                return false;
+            }
+
+            m_operands.push_back(
+                m_ast.addOperator(Ast::Type::Group, nullptr, 0));
+            capture();
+        }
+        else if (accept('['))
+        {
+            std::vector<std::pair<char, char>> sets;
+
+            while (m_pos < m_pattern.size() && !check(']'))
+            {
+                if (m_char == '-' && m_pattern[m_pos - 2] != '\\')
+                {
+                    throw std::runtime_error("invalid character set");
+                }
+
+                char first = std::abs(m_char);
+                getChar();
+
+                char second;
+
+                if (m_char == '-' && m_pattern[m_pos - 2] != '\\')
+                {
+                    getChar();
+
+                    if (check(']') && m_pattern[m_pos - 2] != '\\')
+                    {
+                        throw std::runtime_error("invalid character set");
+                    }
+
+                    second = std::abs(m_char);
+                    getChar();
+                }
+                else
+                {
+                    second = first;
+                }
+
+                if (second < first)
+                {
+                    throw std::runtime_error("invalid character set");
+                }
+
+                sets.emplace_back(std::make_pair(first, second));
+            }
+
+            if (!accept(']'))
+            {
+                throw std::runtime_error("unmatched brackets");
+            }
+
+            m_operands.push_back(m_ast.addCharacterSet(sets));
+        }
+        else if (m_char < 0 && !check('|') && !check(')'))
+        {
+            throw std::runtime_error(
+                "unexpected character '" + std::string(1, -m_char) + "'");
+        }
+        else
+        {
+            m_operands.push_back(m_ast.addCharacter(m_char));
+            getChar();
+        }
+
+        return true;
+    }
+
+private: // fields
+    std::string m_pattern;
+    std::size_t m_pos;
+    char m_char;
+    bool m_captures;
+
+    Ast m_ast;
+    std::vector<Ast::index_t> m_operands;
+    std::vector<Group> m_groups;
+};
+
+/// Rewrites a parsed tree into a smaller one with the same language. Nested
+/// concatenations and groups are flattened and common prefixes are factored
+/// out of alternatives. The character alternatives of a group are merged
+/// into one set, redundant iterations and options are dropped, and
+/// identical subtrees are shared. Captures do not change the language and
+/// are seen through, so a tree comes out the same with or without them.
+class AstOptimizer final
+{
+public: // methods
+    Ast optimize(const Ast &ast)
+    {
+        m_ast = Ast();
+        m_nullable.clear();
+        m_index.clear();
+
+        // Concatenations in concatenations and groups in groups are not
+        // rewritten on their own, their parent takes over their operands.
+        std::vector<bool> inlined(ast.size(), false);
+
+        for (Ast::index_t i = 0; i < ast.size(); i++)
+        {
+            const Ast::Node &node = ast[i];
+
+            if (node.type == Ast::Type::Concatenation ||
+                node.type == Ast::Type::Group)
+            {
+                for (Ast::index_t j = 0; j < node.end - node.begin; j++)
+                {
+                    Ast::index_t child = ast.getChildren(node)[j];
+                    Ast::index_t operand = child;
+
+                    while (ast[operand].type == Ast::Type::Capture)
+                    {
+                        operand = ast.getChildren(ast[operand])[0];
+                    }
+
+                    // Captures around an inlined operand go with it.
+                    for (;; child = ast.getChildren(ast[child])[0])
+                    {
+                        inlined[child] = ast[operand].type == node.type;
+
+                        if (child == operand)
+                        {
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<Ast::index_t> nodes;
+        nodes.reserve(ast.size());
+
+        Nodes stack;
+
+        auto push = [&](const Ast::Node &node) {
+            const Ast::index_t *children = ast.getChildren(node);
+
+            for (Ast::index_t j = node.end - node.begin; j > 0; j--)
+            {
+                stack.push_back(children[j - 1]);
+            }
+        };
+
+        for (Ast::index_t i = 0; i < ast.size(); i++)
+        {
+            const Ast::Node &node = ast[i];
+
+            if (inlined[i])
+            {
+                nodes.push_back(0);
+                continue;
+            }
+
+            Nodes operands;
+
+            if (node.type != Ast::Type::CharacterSet)
+            {
+                push(node);
+            }
+
+            while (!stack.empty())
+            {
+                const Ast::index_t child = stack.back();
+                stack.pop_back();
+
+                // A capture that is not inlined already stands for its
+                // operand, so expanding it again would be quadratic.
+                if (!inlined[child])
+                {
+                    operands.push_back(nodes[child]);
+                    continue;
+                }
+
+                push(ast[child]);
+            }
+
+            switch (node.type)
+            {
+            case Ast::Type::Character:
+                nodes.push_back(character(node.symbol));
+                break;
+
+            case Ast::Type::CharacterSet:
+                nodes.push_back(characterSet(Ranges(
+                    ast.getRanges(node),
+                    ast.getRanges(node) + (node.end - node.begin))));
+                break;
+
+            case Ast::Type::Wildcard:
+                nodes.push_back(wildcard());
+                break;
+
+            case Ast::Type::Concatenation:
+                nodes.push_back(concatenation(operands));
+                break;
+
+            case Ast::Type::Group:
+                nodes.push_back(group(operands));
+                break;
+
+            case Ast::Type::Iteration:
+                nodes.push_back(iteration(operands[0]));
+                break;
+
+            case Ast::Type::Optional:
+                nodes.push_back(option(operands[0]));
+                break;
+
+            case Ast::Type::Capture:
+                nodes.push_back(operands[0]);
+                break;
+            }
+        }
+
+        m_ast.setRoot(nodes[ast.getRoot()]);
+
+        return std::move(m_ast);
+    }
+
+private: // types
+    using Nodes = std::vector<Ast::index_t>;
+    using Ranges = std::vector<std::pair<char, char>>;
+
+private: // methods
+    Ast::index_t character(char c)
+    {
+        return intern(Ast::Type::Character, c, {}, {});
+    }
+
+    /// Sorts and joins the ranges. A set of one character becomes a
+    /// character, a set of every byte a wildcard, an empty set the empty
+    /// group.
+    Ast::index_t characterSet(Ranges ranges)
+    {
+        auto less = [](
+            const std::pair<char, char> &a, const std::pair<char, char> &b) {
+            return std::make_pair(
+                       static_cast<unsigned char>(a.first),
+                       static_cast<unsigned char>(a.second)) <
+                   std::make_pair(
+                       static_cast<unsigned char>(b.first),
+                       static_cast<unsigned char>(b.second));
+        };
+
+        std::sort(ranges.begin(), ranges.end(), less);
+
+        Ranges joined;
+
+        for (const auto &range : ranges)
+        {
+            if (!joined.empty() &&
+                static_cast<unsigned char>(range.first) <=
+                    static_cast<unsigned char>(joined.back().second) + 1)
+            {
+                joined.back().second = std::max(
+                    joined.back().second, range.second, [](char a, char b) {
+                        return static_cast<unsigned char>(a) <
+                               static_cast<unsigned char>(b);
+                    });
+            }
+            else
+            {
+                joined.push_back(range);
+            }
+        }
+
+        if (joined.empty())
+        {
+            return empty();
+        }
+
+        if (joined.size() == 1 && joined[0].first == joined[0].second)
+        {
+            return character(joined[0].first);
+        }
+
+        if (joined.size() == 1 && joined[0].first == '\x01' &&
+            joined[0].second == '\xff')
+        {
+            return wildcard();
+        }
+
+        return intern(Ast::Type::CharacterSet, '\0', {}, joined);
+    }
+
+    Ast::index_t wildcard()
+    {
+        return intern(Ast::Type::Wildcard, '\0', {}, {});
+    }
+
+    Ast::index_t epsilon()
+    {
+        return intern(Ast::Type::Concatenation, '\0', {}, {});
+    }
+
+    Ast::index_t empty()
+    {
+        return intern(Ast::Type::Group, '\0', {}, {});
+    }
+
+    Ast::index_t concatenation(const Nodes &nodes)
+    {
+        Nodes operands;
+
+        for (Ast::index_t node : nodes)
+        {
+            if (is(node, Ast::Type::Concatenation))
+            {
+                append(operands, node);
+            }
+            else if (isEmpty(node))
+            {
+                return node;
+            }
+            else
+            {
+                operands.push_back(node);
+            }
+        }
+
+        if (operands.size() == 1)
+        {
+            return operands[0];
+        }
+
+        return intern(Ast::Type::Concatenation, '\0', operands, {});
+    }
+
+    /// Factors the alternatives through a trie of their operand sequences,
+    /// so alternatives sharing a prefix share its nodes. The trie is emitted
+    /// from the leaves up, each branching node becoming an alternation.
+    Ast::index_t group(const Nodes &nodes)
+    {
+        std::vector<std::vector<std::pair<Ast::index_t, std::size_t>>> edges(1);
+        std::vector<bool> ends(1, false);
+        std::map<std::pair<std::size_t, Ast::index_t>, std::size_t> targets;
+
+        Nodes alternatives;
+
+        for (Ast::index_t node : nodes)
+        {
+            if (is(node, Ast::Type::Group))
+            {
+                append(alternatives, node);
+            }
+            else
+            {
+                alternatives.push_back(node);
+            }
+        }
+
+        for (Ast::index_t alternative : alternatives)
+        {
+            Nodes sequence;
+
+            if (is(alternative, Ast::Type::Concatenation))
+            {
+                append(sequence, alternative);
+            }
+            else
+            {
+                sequence.push_back(alternative);
+            }
+
+            std::size_t t = 0;
+
+            for (Ast::index_t node : sequence)
+            {
+                auto it = targets.find(std::make_pair(t, node));
+
+                if (it == targets.end())
+                {
+                    it = targets.emplace(std::make_pair(t, node), edges.size())
+                             .first;
+                    edges[t].emplace_back(node, edges.size());
+                    edges.emplace_back();
+                    ends.push_back(false);
+                }
+
+                t = it->second;
+            }
+
+            ends[t] = true;
+        }
+
+        if (edges[0].empty())
+        {
+            return ends[0] ? epsilon() : empty();
+        }
+
+        // The operands following each trie node, in reverse.
+        std::vector<Nodes> suffixes(edges.size());
+
+        for (std::size_t t = edges.size(); t-- > 0;)
+        {
+            if (edges[t].empty())
+            {
+                continue;
+            }
+
+            if (edges[t].size() == 1 && !ends[t])
+            {
+                suffixes[t] = std::move(suffixes[edges[t][0].second]);
+                suffixes[t].push_back(edges[t][0].first);
+                continue;
+            }
+
+            Nodes options;
+
+            for (const auto &edge : edges[t])
+            {
+                Nodes &suffix = suffixes[edge.second];
+                suffix.push_back(edge.first);
+
+                options.push_back(
+                    concatenation(Nodes(suffix.rbegin(), suffix.rend())));
+                suffix = Nodes();
+            }
+
+            if (ends[t])
+            {
+                options.push_back(epsilon());
+            }
+
+            suffixes[t] = {alternation(options)};
+        }
+
+        return concatenation(Nodes(suffixes[0].rbegin(), suffixes[0].rend()));
+    }
+
+    /// Joins alternatives without factoring them, merging the character
+    /// alternatives into one set and an empty alternative into an option.
+    Ast::index_t alternation(const Nodes &nodes)
+    {
+        Nodes alternatives;
+
+        for (Ast::index_t node : nodes)
+        {
+            if (is(node, Ast::Type::Group))
+            {
+                append(alternatives, node);
+            }
+            else
+            {
+                alternatives.push_back(node);
+            }
+        }
+
+        Nodes operands;
+        Ranges ranges;
+        std::size_t set = alternatives.size();
+        bool optional = false;
+
+        for (Ast::index_t node : alternatives)
+        {
+            if (isEpsilon(node))
+            {
+                optional = true;
+            }
+            else if (!appendRanges(ranges, node))
+            {
+                operands.push_back(node);
+            }
+            else if (set == alternatives.size())
+            {
+                set = operands.size();
+                operands.push_back(node);
+            }
+        }
+
+        if (set < operands.size())
+        {
+            operands[set] = characterSet(ranges);
+        }
+
+        if (operands.empty())
+        {
+            return optional ? epsilon() : empty();
+        }
+
+        Ast::index_t res;
+
+        if (operands.size() == 1)
+        {
+            res = operands[0];
+        }
+        else
+        {
+            res = intern(Ast::Type::Group, '\0', operands, {});
+        }
+
+        return optional ? option(res) : res;
+    }
+
+    /// (x+)+ is x+ and (x?)+ is (x+)?.
+    Ast::index_t iteration(Ast::index_t node)
+    {
+        if (is(node, Ast::Type::Iteration) || isEpsilon(node) ||
+            isEmpty(node))
+        {
+            return node;
+        }
+
+        if (is(node, Ast::Type::Optional))
+        {
+            return option(iteration(*m_ast.getChildren(m_ast[node])));
+        }
+
+        return intern(Ast::Type::Iteration, '\0', {node}, {});
+    }
+
+    /// Options of expressions matching the empty string are dropped.
+    Ast::index_t option(Ast::index_t node)
+    {
+        if (m_nullable[node])
+        {
+            return node;
+        }
+
+        if (isEmpty(node))
+        {
+            return epsilon();
+        }
+
+        return intern(Ast::Type::Optional, '\0', {node}, {});
+    }
+
+    bool is(Ast::index_t node, Ast::Type type) const
+    {
+        return m_ast[node].type == type;
+    }
+
+    bool isEpsilon(Ast::index_t node) const
+    {
+        const Ast::Node &n = m_ast[node];
+        return n.type == Ast::Type::Concatenation && n.begin == n.end;
+    }
+
+    /// The empty group, which matches nothing.
+    bool isEmpty(Ast::index_t node) const
+    {
+        const Ast::Node &n = m_ast[node];
+        return n.type == Ast::Type::Group && n.begin == n.end;
+    }
+
+    /// Appends the bytes matched by a character, character set or wildcard
+    /// to @p ranges. Returns false for other nodes.
+    bool appendRanges(Ranges &ranges, Ast::index_t node) const
+    {
+        const Ast::Node &n = m_ast[node];
+
+        switch (n.type)
+        {
+        case Ast::Type::Character:
+            ranges.emplace_back(n.symbol, n.symbol);
+            return true;
+
+        case Ast::Type::CharacterSet:
+            ranges.insert(
+                ranges.end(),
+                m_ast.getRanges(n),
+                m_ast.getRanges(n) + (n.end - n.begin));
+            return true;
+
+        case Ast::Type::Wildcard:
+            ranges.emplace_back('\x01', '\xff');
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    /// Appends the operands of @p node to @p nodes.
+    void append(Nodes &nodes, Ast::index_t node) const
+    {
+        const Ast::Node &n = m_ast[node];
+        const Ast::index_t *children = m_ast.getChildren(n);
+
+        nodes.insert(nodes.end(), children, children + (n.end - n.begin));
+    }
+
+    /// Returns the existing node with these contents or adds a new one.
+    Ast::index_t intern(
+        Ast::Type type,
+        char symbol,
+        const Nodes &children,
+        const Ranges &ranges)
+    {
+        std::size_t hash = static_cast<std::size_t>(type) * 31 +
+                           static_cast<unsigned char>(symbol);
+
+        for (Ast::index_t child : children)
+        {
+            hash = hash * 31 + child;
+        }
+
+        for (const auto &range : ranges)
+        {
+            hash = (hash * 31 + static_cast<unsigned char>(range.first)) * 31 +
+                   static_cast<unsigned char>(range.second);
+        }
+
+        auto candidates = m_index.equal_range(hash);
+
+        for (auto it = candidates.first; it != candidates.second; ++it)
+        {
+            const Ast::Node &node = m_ast[it->second];
+            const std::size_t count = node.end - node.begin;
+
+            if (node.type != type || node.symbol != symbol)
+            {
+                continue;
+            }
+
+            if (type == Ast::Type::CharacterSet
+                    ? count == ranges.size() &&
+                          std::equal(
+                              ranges.begin(),
+                              ranges.end(),
+                              m_ast.getRanges(node))
+                    : count == children.size() &&
+                          std::equal(
+                              children.begin(),
+                              children.end(),
+                              m_ast.getChildren(node)))
+            {
+                return it->second;
+            }
+        }
+
+        Ast::index_t index;
+        bool nullable = false;
+
+        switch (type)
+        {
+        case Ast::Type::Character:
+            index = m_ast.addCharacter(symbol);
+            break;
+
+        case Ast::Type::CharacterSet:
+            index = m_ast.addCharacterSet(ranges);
+            break;
+
+        case Ast::Type::Wildcard:
+            index = m_ast.addWildcard();
+            break;
+
+        default:
+            index = m_ast.addOperator(type, children.data(), children.size());
+
+            nullable = type == Ast::Type::Optional ||
+                       type == Ast::Type::Concatenation;
+
+            for (Ast::index_t child : children)
+            {
+                if (type == Ast::Type::Concatenation)
+                {
+                    nullable = nullable && m_nullable[child];
+                }
+                else
+                {
+                    nullable = nullable || m_nullable[child];
+                }
+            }
+            break;
+        }
+
+        m_index.emplace(hash, index);
+        m_nullable.push_back(nullable);
+
+        return index;
+    }
+
+private: // fields
+    Ast m_ast;
+    std::vector<bool> m_nullable;
+    std::unordered_multimap<std::size_t, Ast::index_t> m_index;
+};
+
+class RegexImpl final
+{
+public: // methods
+    /// The pattern is parsed once, keeping its captures for capture(), and
+    /// the optimized tree gives both the automaton and the prefilter.
+    RegexImpl(const std::string &pattern, Regex::Engine engine)
+        : m_ast{RegexParser().parse(pattern, true)}
+        , m_optimized{AstOptimizer().optimize(m_ast)}
+        , m_engine{engine}
+        , m_prefilter{m_optimized.getRequiredLiteral()}
+    {
+        Fsm fsm = m_optimized.glushkov();
+
+        switch (m_engine)
+        {
+        case Regex::Engine::Dfa:
+            m_dfa.reset(new Dfa(fsm.min()));
+            break;
+
+        case Regex::Engine::LazyDfa:
+            m_lazy_dfa.reset(new LazyDfa(fsm));
+            break;
+
+        case Regex::Engine::Nfa:
+            m_nfa.reset(new Nfa(fsm));
+            break;
+        }
+    }
+
+    bool match(const std::string &str)
+    {
+        if (!isCandidate(str))
+        {
+            return false;
+        }
+
+        switch (m_engine)
+        {
+        case Regex::Engine::Dfa:
+            return m_dfa->match(str.data(), str.size());
+
+        case Regex::Engine::LazyDfa:
+            return m_lazy_dfa->match(str.data(), str.size());
+
+        case Regex::Engine::Nfa:
+            return m_nfa->match(str.data(), str.size());
+        }
+
+        return false;
+    }
+
+    bool match(const std::string &str, std::size_t threads)
+    {
+        if (m_engine == Regex::Engine::Dfa)
+        {
+            return isCandidate(str) &&
+                   m_dfa->matchParallel(str.data(), str.size(), threads);
+        }
+
+        return match(str);
+    }
+
+    std::vector<Regex::Span> find(const std::string &str, bool all)
+    {
+        if (!isCandidate(str))
+        {
+            return {};
+        }
+
+        prepareSearch();
+
+        if (m_engine == Regex::Engine::Dfa)
+        {
+            return search(*m_dfa, *m_reverse, str, all);
+        }
+
+        return search(*m_lazy_dfa, *m_lazy_reverse, str, all);
+    }
+
+    /// The tagged automaton is built from the unoptimized tree, because the
+    /// optimizer sees through the captures.
+    bool capture(const std::string &str, std::vector<Regex::Span> &groups)
+    {
+        if (!isCandidate(str))
+        {
+            return false;
+        }
+
+        if (!m_tagged)
+        {
+            m_tagged.reset(new TaggedNfa(m_ast.tagged()));
+        }
+
+        if (!m_tagged->match(str.data(), str.size(), m_offsets))
+        {
+            return false;
+        }
+
+        groups.resize(m_offsets.size() / 2);
+
+        for (std::size_t g = 0; g < groups.size(); g++)
+        {
+            groups[g] = {m_offsets[2 * g], m_offsets[2 * g + 1]};
+        }
+
+        return true;
+    }
+
+    Stream stream(Stream::Callback callback) const
+    {
+        if (m_engine != Regex::Engine::Dfa)
+        {
+            throw std::runtime_error("stream matching requires the DFA engine");
+        }
+
+        return Stream(*m_dfa, callback);
+    }
+
+private: // types
+    /// States of a forward run of find() from the offset @p begin on.
+    template <class Automaton>
+    struct Trace
+    {
+        std::size_t begin;
+        std::vector<typename Automaton::state_t> states;
+    };
+
+private: // methods
+    /// Builds the automata for find() on first use: the forward one, if the
+    /// engine did not build it, and the reverse of the automaton matching
+    /// every string that starts with a match. Only the DFA engine
+    /// determinizes them eagerly; the other engines search with lazy DFAs.
+    void prepareSearch()
+    {
+        if (m_reverse || m_lazy_reverse)
+        {
+            return;
+        }
+
+        Fsm fsm = m_optimized.glushkov();
+
+        if (m_engine != Regex::Engine::Dfa && !m_lazy_dfa)
+        {
+            m_lazy_dfa.reset(new LazyDfa(fsm));
+        }
+
+        for (Fsm::state_t s : fsm.getFinalStates())
+        {
+            fsm.connect(s, s, '\x01', '\xff');
+        }
+
+        if (m_engine == Regex::Engine::Dfa)
+        {
+            m_reverse.reset(new Dfa(fsm.rev().min()));
+        }
+        else
+        {
+            m_lazy_reverse.reset(new LazyDfa(fsm.rev()));
+        }
+    }
+
+    /// A backward pass of the reverse automaton marks every offset at which
+    /// a match starts. From the leftmost such offset, the forward automaton
+    /// runs until it dies, and its last accepting offset ends the longest
+    /// match. The search resumes at the end of the match.
+    ///
+    /// Every later run starts past the matches of the earlier ones, so an
+    /// earlier run does not accept after the end of its match. A run that
+    /// reaches a state at an offset where an earlier run was in the same
+    /// state past its match cannot accept anymore either, and stops there.
+    /// This keeps the search linear in the input however far the runs go.
+    template <class Automaton>
+    std::vector<Regex::Span> search(
+        Automaton &forward,
+        Automaton &reverse,
+        const std::string &str,
+        bool all)
+    {
+        using state_t = typename Automaton::state_t;
+
+        std::vector<Regex::Span> spans;
+
+        const char *data = str.data();
+        const std::size_t size = str.size();
+
+        state_t state = reverse.getStartingState();
+
+        std::vector<bool> starts(size + 1);
+        starts[size] = reverse.isFinal(state);
+
+        for (std::size_t i = size; i-- > 0;)
+        {
+            // No match contains '\0', so the text after it does not matter.
+            state = data[i] ? reverse.next(state, data[i])
+                            : reverse.getStartingState();
+            starts[i] = reverse.isFinal(state);
+        }
+
+        std::vector<Trace<Automaton>> traces;
+        Trace<Automaton> run;
+        std::size_t flushes = getFlushCount(forward);
+
+        std::size_t begin = 0;
+
+        while (begin <= size)
+        {
+            if (!starts[begin])
+            {
+                begin++;
+                continue;
+            }
+
+            traces.erase(
+                std::remove_if(
+                    traces.begin(),
+                    traces.end(),
+                    [&](const Trace<Automaton> &trace) {
+                        return trace.begin + trace.states.size() <= begin;
+                    }),
+                traces.end());
+
+            state = forward.getStartingState();
+            std::size_t end = begin;
+
+            run.begin = begin;
+            run.states.clear();
+
+            for (std::size_t i = begin;; i++)
+            {
+                if (forward.isFinal(state))
+                {
+                    end = i;
+                }
+
+                if (isTraced(traces, i, state))
+                {
+                    break;
+                }
+
+                run.states.push_back(state);
+
+                if (i == size)
+                {
+                    break;
+                }
+
+                state = forward.next(state, data[i]);
+
+                if (state == Automaton::dead_state)
+                {
+                    break;
+                }
+
+                // A flushed lazy DFA renumbers its states.
+                if (getFlushCount(forward) != flushes)
+                {
+                    flushes = getFlushCount(forward);
+                    traces.clear();
+                    run.begin = i + 1;
+                    run.states.clear();
+                }
+            }
+
+            if (end > run.begin)
+            {
+                const std::size_t matched =
+                    std::min(end - run.begin, run.states.size());
+                run.states.erase(
+                    run.states.begin(), run.states.begin() + matched);
+                run.begin += matched;
+            }
+
+            if (!run.states.empty())
+            {
+                traces.push_back(run);
+            }
+
+            spans.push_back({begin, end});
+
+            if (!all)
+            {
+                break;
+            }
+
+            begin = end > begin ? end : begin + 1;
+        }
+
+        return spans;
+    }
+
+    template <class Automaton>
+    static bool isTraced(
+        const std::vector<Trace<Automaton>> &traces,
+        std::size_t offset,
+        typename Automaton::state_t state)
+    {
+        for (const Trace<Automaton> &trace : traces)
+        {
+            if (offset >= trace.begin &&
+                offset - trace.begin < trace.states.size() &&
+                trace.states[offset - trace.begin] == state)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static std::size_t getFlushCount(const Dfa &)
+    {
+        return 0;
+    }
+
+    static std::size_t getFlushCount(const LazyDfa &dfa)
+    {
+        return dfa.getFlushCount();
+    }
+
+    /// False if the string lacks a literal that every match contains.
+    bool isCandidate(const std::string &str) const
+    {
+        return m_prefilter.find(str.data(), str.data() + str.size());
+    }
+
+private: // fields
+    Ast m_ast;
+    Ast m_optimized;
+    Regex::Engine m_engine;
+    LiteralFinder m_prefilter;
+    std::unique_ptr<Dfa> m_dfa;
+    std::unique_ptr<Dfa> m_reverse;
+    std::unique_ptr<LazyDfa> m_lazy_dfa;
+    std::unique_ptr<LazyDfa> m_lazy_reverse;
+    std::unique_ptr<Nfa> m_nfa;
+    std::unique_ptr<TaggedNfa> m_tagged;
+    std::vector<std::size_t> m_offsets;
+};
+
+Regex::Regex(const std::string &pattern, Engine engine)
+    : m_impl{new RegexImpl{pattern, engine}}
+{
+}
+
+Regex::Regex(Regex &&other) = default;
+
+Regex::~Regex() = default;
+
+Regex &Regex::operator=(Regex &&other) = default;
+
+bool Regex::match(const std::string &str)
+{
+    return m_impl->match(str);
+}
+
+bool Regex::match(const std::string &str, std::size_t threads)
+{
+    return m_impl->match(str, threads);
+}
+
+bool Regex::find(const std::string &str, Span &span)
+{
+    std::vector<Span> spans = m_impl->find(str, false);
+
+    if (spans.empty())
+    {
+        return false;
+    }
+
+    span = spans[0];
+    return true;
+}
+
+std::vector<Regex::Span> Regex::findAll(const std::string &str)
+{
+    return m_impl->find(str, true);
+}
+
+bool Regex::capture(const std::string &str, std::vector<Span> &groups)
+{
+    return m_impl->capture(str, groups);
+}
+
+Stream Regex::stream(Stream::Callback callback) const
+{
+    return m_impl->stream(callback);
+}
+
+Fsm Regex::buildFsm(const std::string &pattern, Construction construction)
+{
+    std::string literal;
+    return buildFsm(pattern, literal, construction);
+}
+
+Fsm Regex::buildFsm(
+    const std::string &pattern,
+    std::string &literal,
+    Construction construction)
+{
+    Ast ast = AstOptimizer().optimize(RegexParser().parse(pattern));
+    literal = ast.getRequiredLiteral();
+
+    switch (construction)
+    {
+    case Construction::Thompson:
+        return ast.compile();
+
+    case Construction::Glushkov:
+        break;
+    }
+
+    return ast.glushkov();
 }
 
-Fsm Regex::buildFsm(const std::string &pattern)
+std::string Regex::requiredLiteral(const std::string &pattern)
 {
-    return RegexParser().parse(pattern)->compile();
+    return AstOptimizer()
+        .optimize(RegexParser().parse(pattern))
+        .getRequiredLiteral();
 }
 
 #undef FOREACH_TEMPLATE_PACK
@@ -0,0 +1,105 @@
+#include "fsm/RegexSet.hpp"
+#include <algorithm>
+#include "fsm/Fsm.hpp"
+#include "fsm/Regex.hpp"
+
+namespace fsm {
+
+RegexSet::RegexSet(const std::vector<std::string> &patterns)
+    : m_size{patterns.size()}
+    , m_dfa{compile(patterns, m_matches)}
+{
+}
+
+std::size_t RegexSet::size() const
+{
+    return m_size;
+}
+
+std::vector<std::size_t> RegexSet::match(const std::string &str) const
+{
+    Dfa::state_t state = m_dfa.run(
+        m_dfa.getStartingState(), str.data(), str.data() + str.size());
+
+    return m_matches[m_dfa.getIndex(state)];
+}
+
+bool RegexSet::matchAny(const std::string &str) const
+{
+    return m_dfa.match(str.data(), str.size());
+}
+
+/// Builds the union of the minimized pattern automata under a fresh starting
+/// state and determinizes it, then tags every state of the result with the
+/// patterns whose accepting states it contains.
+Dfa RegexSet::compile(
+    const std::vector<std::string> &patterns,
+    std::vector<std::vector<std::size_t>> &matches)
+{
+    std::vector<Fsm> fsms;
+    std::size_t states_num = 1;
+
+    for (const std::string &pattern : patterns)
+    {
+        fsms.emplace_back(Regex::buildFsm(pattern).min());
+        states_num += fsms.back().getTransitions().size();
+    }
+
+    Fsm fsm(states_num);
+    fsm.setStarting(0);
+
+    std::vector<std::size_t> pattern_ids(states_num);
+    std::size_t global_index = 1;
+
+    for (std::size_t id = 0; id < fsms.size(); id++)
+    {
+        const auto &transitions = fsms[id].getTransitions();
+
+        for (Fsm::state_t s = 0; s < transitions.size(); s++)
+        {
+            for (const Fsm::Transition &tr : transitions[s])
+            {
+                fsm.connect(
+                    global_index + s,
+                    global_index + tr.state,
+                    tr.first,
+                    tr.last);
+            }
+        }
+
+        for (Fsm::state_t s : fsms[id].getStartingStates())
+        {
+            fsm.connect(0, global_index + s, '\0');
+        }
+
+        for (Fsm::state_t s : fsms[id].getFinalStates())
+        {
+            fsm.setFinal(global_index + s);
+            pattern_ids[global_index + s] = id;
+        }
+
+        global_index += transitions.size();
+    }
+
+    std::vector<std::set<Fsm::state_t>> final_states;
+    Fsm dfa = fsm.det(final_states);
+
+    matches.assign(final_states.size() + 1, {});
+
+    for (std::size_t i = 0; i < final_states.size(); i++)
+    {
+        for (Fsm::state_t s : final_states[i])
+        {
+            matches[i + 1].push_back(pattern_ids[s]);
+        }
+
+        std::sort(matches[i + 1].begin(), matches[i + 1].end());
+        matches[i + 1].erase(
+            std::unique(matches[i + 1].begin(), matches[i + 1].end()),
+            matches[i + 1].end());
+    }
+
+    return Dfa(dfa);
+}
+
+} // namespace fsm
@@ -0,0 +1,64 @@
+#include "fsm/Stream.hpp"
+
+namespace fsm {
+
+Stream::Stream(const Dfa &dfa, Callback callback)
+    : m_dfa(dfa)
+    , m_callback{callback}
+    , m_state{dfa.getStartingState()}
+    , m_offset{0}
+{
+    if (m_callback && m_dfa.isFinal(m_state))
+    {
+        m_callback(m_offset);
+    }
+}
+
+void Stream::feed(const char *data, std::size_t size)
+{
+    if (!m_callback || m_state == Dfa::dead_state)
+    {
+        m_state = m_dfa.run(m_state, data, data + size);
+        m_offset += size;
+        return;
+    }
+
+    for (std::size_t i = 0; i < size; i++)
+    {
+        m_state = m_dfa.next(m_state, data[i]);
+
+        if (m_state == Dfa::dead_state)
+        {
+            break;
+        }
+
+        if (m_dfa.isFinal(m_state))
+        {
+            m_callback(m_offset + i + 1);
+        }
+    }
+
+    m_offset += size;
+}
+
+void Stream::reset()
+{
+    m_state = m_dfa.getStartingState();
+
+    if (m_callback && m_dfa.isFinal(m_state))
+    {
+        m_callback(m_offset);
+    }
+}
+
+bool Stream::isMatch() const
+{
+    return m_dfa.isFinal(m_state);
+}
+
+std::uint64_t Stream::getOffset() const
+{
+    return m_offset;
+}
+
+} // namespace fsm
@@ -0,0 +1,250 @@
+#include "fsm/TaggedNfa.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace fsm {
+
+constexpr std::size_t TaggedNfa::npos;
+
+TaggedNfa::TaggedNfa(const std::vector<State> &states, std::size_t tags)
+    : m_tag_count{tags}
+{
+    m_edges_begin.reserve(states.size() + 1);
+
+    for (const State &state : states)
+    {
+        m_edges_begin.push_back(m_edges.size());
+
+        for (const Transition &tr : state.transitions)
+        {
+            auto range = addTags(tr.tags);
+
+            m_edges.push_back(
+                {tr.state,
+                 static_cast<unsigned char>(tr.first),
+                 static_cast<unsigned char>(tr.last),
+                 range.first,
+                 range.second});
+        }
+
+        m_final_states.push_back(state.final);
+        m_final_tags.push_back(addTags(state.final_tags));
+    }
+
+    m_edges_begin.push_back(m_edges.size());
+    m_visited.assign(states.size(), false);
+
+    buildTable();
+}
+
+bool TaggedNfa::isOnePass() const
+{
+    return !m_table.empty();
+}
+
+bool TaggedNfa::match(
+    const char *data,
+    std::size_t size,
+    std::vector<std::size_t> &offsets)
+{
+    if (isOnePass())
+    {
+        return matchOnePass(data, size, offsets);
+    }
+
+    return matchThreads(data, size, offsets);
+}
+
+std::pair<std::uint32_t, std::uint32_t> TaggedNfa::addTags(
+    const std::vector<tag_t> &tags)
+{
+    const std::uint32_t begin = m_tags.size();
+    m_tags.insert(m_tags.end(), tags.begin(), tags.end());
+    return std::make_pair(begin, static_cast<std::uint32_t>(m_tags.size()));
+}
+
+/// Leaves the table empty if some state has two different edges on a byte.
+void TaggedNfa::buildTable()
+{
+    for (const Edge &edge : m_edges)
+    {
+        ByteClasses::bytes_t bytes;
+
+        for (std::size_t b = edge.first; b <= edge.last; b++)
+        {
+            bytes.set(b);
+        }
+
+        m_classes.split(bytes);
+    }
+
+    const std::size_t stride = m_classes.size();
+    std::vector<std::uint32_t> table(m_final_states.size() * stride, 0);
+
+    for (std::size_t s = 0; s < m_final_states.size(); s++)
+    {
+        for (std::uint32_t e = m_edges_begin[s]; e < m_edges_begin[s + 1]; e++)
+        {
+            const Edge &edge = m_edges[e];
+            auto classes = m_classes.getClassRange(
+                static_cast<char>(edge.first), static_cast<char>(edge.last));
+
+            for (std::size_t c = classes.first; c < classes.second; c++)
+            {
+                std::uint32_t &entry = table[s * stride + c];
+
+                if (!entry)
+                {
+                    entry = e + 1;
+                }
+                else if (!isSameEdge(m_edges[entry - 1], edge))
+                {
+                    return;
+                }
+            }
+        }
+    }
+
+    m_table = std::move(table);
+}
+
+/// Edges to the same state with the same tags, which no path can tell apart.
+bool TaggedNfa::isSameEdge(const Edge &a, const Edge &b) const
+{
+    return a.state == b.state &&
+           a.tags_end - a.tags_begin == b.tags_end - b.tags_begin &&
+           std::equal(
+               m_tags.begin() + a.tags_begin,
+               m_tags.begin() + a.tags_end,
+               m_tags.begin() + b.tags_begin);
+}
+
+bool TaggedNfa::matchOnePass(
+    const char *data,
+    std::size_t size,
+    std::vector<std::size_t> &offsets) const
+{
+    const std::size_t stride = m_classes.size();
+
+    offsets.assign(m_tag_count, npos);
+    state_t state = 0;
+
+    for (std::size_t i = 0; i < size; i++)
+    {
+        const std::uint32_t entry =
+            m_table[state * stride + m_classes[data[i]]];
+
+        if (!entry)
+        {
+            return false;
+        }
+
+        const Edge &edge = m_edges[entry - 1];
+        record(offsets.data(), edge.tags_begin, edge.tags_end, i);
+        state = edge.state;
+    }
+
+    if (!m_final_states[state])
+    {
+        return false;
+    }
+
+    record(
+        offsets.data(),
+        m_final_tags[state].first,
+        m_final_tags[state].second,
+        size);
+
+    return true;
+}
+
+/// Keeps the active states in order of priority, each followed by its tags
+/// in the offset buffer.
+bool TaggedNfa::matchThreads(
+    const char *data,
+    std::size_t size,
+    std::vector<std::size_t> &offsets)
+{
+    m_current.assign(1, 0);
+    m_current_offsets.assign(m_tag_count, npos);
+
+    for (std::size_t i = 0; i < size && !m_current.empty(); i++)
+    {
+        const unsigned char c = data[i];
+
+        m_next.clear();
+        m_next_offsets.clear();
+
+        for (std::size_t t = 0; t < m_current.size(); t++)
+        {
+            const state_t s = m_current[t];
+            auto thread = m_current_offsets.begin() + t * m_tag_count;
+
+            for (std::uint32_t e = m_edges_begin[s]; e < m_edges_begin[s + 1];
+                 e++)
+            {
+                const Edge &edge = m_edges[e];
+
+                if (c < edge.first || c > edge.last || m_visited[edge.state])
+                {
+                    continue;
+                }
+
+                m_visited[edge.state] = true;
+                m_next.push_back(edge.state);
+                m_next_offsets.insert(
+                    m_next_offsets.end(), thread, thread + m_tag_count);
+
+                record(
+                    m_next_offsets.data() + m_next_offsets.size() -
+                        m_tag_count,
+                    edge.tags_begin,
+                    edge.tags_end,
+                    i);
+            }
+        }
+
+        for (state_t s : m_next)
+        {
+            m_visited[s] = false;
+        }
+
+        std::swap(m_current, m_next);
+        std::swap(m_current_offsets, m_next_offsets);
+    }
+
+    for (std::size_t t = 0; t < m_current.size(); t++)
+    {
+        const state_t s = m_current[t];
+
+        if (m_final_states[s])
+        {
+            auto thread = m_current_offsets.begin() + t * m_tag_count;
+            offsets.assign(thread, thread + m_tag_count);
+
+            record(
+                offsets.data(),
+                m_final_tags[s].first,
+                m_final_tags[s].second,
+                size);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TaggedNfa::record(
+    std::size_t *offsets,
+    std::uint32_t begin,
+    std::uint32_t end,
+    std::size_t offset) const
+{
+    for (std::uint32_t i = begin; i < end; i++)
+    {
+        offsets[m_tags[i]] = offset;
+    }
+}
+
+} // namespace fsm
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Identifier.hpp"
+#include "Integer.hpp"
+#include "Loops.hpp"
+#include "Wildcard.hpp"
+#include "fsm/Regex.hpp"
+
+namespace {
+
+/// The patterns are the ones given to fsm_generate_regex().
+struct Test
+{
+    const char *pattern;
+    bool (*match)(const std::string &);
+};
+
+const Test c_tests[] = {
+    {"[a-z_][a-z_0-9]*", fsm::generated::Identifier::match},
+    {"-?(0|[1-9][0-9]*)", fsm::generated::Integer::match},
+    {"(ab|a)*(c|)", fsm::generated::Loops::match},
+    {"a.*b", fsm::generated::Wildcard::match},
+};
+
+const std::string c_alphabet = "abc_-09\xff";
+const std::size_t c_max_size = 5;
+
+} // namespace
+
+/// Checks the generated matchers against Regex::match() on every string over
+/// a few bytes that the patterns treat differently.
+int main()
+{
+    std::vector<std::string> strings{""};
+
+    for (std::size_t i = 0; i < strings.size(); i++)
+    {
+        if (strings[i].size() < c_max_size)
+        {
+            for (char c : c_alphabet)
+            {
+                strings.push_back(strings[i] + c);
+            }
+        }
+    }
+
+    std::size_t checks = 0;
+    std::size_t failures = 0;
+
+    for (const Test &test : c_tests)
+    {
+        fsm::Regex regex(test.pattern);
+
+        for (const std::string &str : strings)
+        {
+            checks++;
+
+            if (test.match(str) != regex.match(str))
+            {
+                std::cerr << test.pattern << " on \"" << str << "\""
+                          << std::endl;
+                failures++;
+            }
+        }
+    }
+
+    std::cout << "gen: " << checks << " checks, " << failures << " failures"
+              << std::endl;
+
+    return failures ? 1 : 0;
+}
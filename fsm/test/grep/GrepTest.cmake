@@ -0,0 +1,60 @@
+# Runs fsmgrep on small files and checks its output and exit status.
+#
+# Expects FSM_GREP, the path of the tool, and WORK_DIR, where the input
+# files are written.
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+file(WRITE ${WORK_DIR}/one.txt "abc\nxyz\nab\nbcd\n")
+file(WRITE ${WORK_DIR}/two.txt "aab\nb\n")
+
+# Well over the size of a chunk, with matching lines on either side of every
+# chunk boundary.
+set(big "a\nbb\n")
+
+foreach(i RANGE 20)
+    set(big "${big}${big}")
+endforeach()
+
+file(WRITE ${WORK_DIR}/big.txt "${big}")
+
+# Runs fsmgrep with the remaining arguments, reading INPUT if it is not
+# empty, and compares the exit status and the output.
+function(check NAME INPUT EXPECTED_RESULT EXPECTED_OUTPUT)
+    if(INPUT)
+        set(input INPUT_FILE ${INPUT})
+    endif()
+
+    execute_process(
+        COMMAND ${FSM_GREP} ${ARGN}
+        WORKING_DIRECTORY ${WORK_DIR}
+        ${input}
+        RESULT_VARIABLE result
+        OUTPUT_VARIABLE output
+        ERROR_QUIET
+        )
+
+    if(NOT result STREQUAL EXPECTED_RESULT)
+        message(SEND_ERROR "${NAME}: exit status ${result}")
+    elseif(NOT output STREQUAL EXPECTED_OUTPUT)
+        message(SEND_ERROR "${NAME}: output\n${output}")
+    endif()
+endfunction()
+
+check(search "" 0 "abc\nab\n" ab one.txt)
+check(count "" 0 "2\n" -c ab one.txt)
+check(invert "" 0 "xyz\nbcd\n" -v ab one.txt)
+check(whole_line "" 0 "ab\n" -x ab one.txt)
+check(files "" 0 "one.txt:abc\none.txt:ab\ntwo.txt:aab\n" ab one.txt two.txt)
+check(file_counts "" 0 "one.txt:2\ntwo.txt:1\n" -c ab one.txt two.txt)
+check(stdin ${WORK_DIR}/one.txt 0 "xyz\n" y)
+check(stdin_count ${WORK_DIR}/one.txt 0 "2\n" -c ab)
+check(stdin_invert ${WORK_DIR}/one.txt 0 "xyz\nbcd\n" -v ab)
+check(no_match "" 1 "" q one.txt)
+check(no_count "" 1 "0\n" -c q one.txt)
+check(bad_pattern "" 2 "" "(a" one.txt)
+check(missing_file "" 2 "" ab missing.txt)
+check(no_pattern "" 2 "")
+check(bad_option "" 2 "" -q ab one.txt)
+check(threads "" 0 "2097152\n" -c -j4 -x b+ big.txt)
+check(one_thread "" 0 "2097152\n" -c -j1 -x b+ big.txt)
+check(stdin_threads ${WORK_DIR}/big.txt 0 "2097152\n" -c -j4 -x b+)
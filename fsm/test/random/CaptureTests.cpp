@@ -0,0 +1,86 @@
+#include <regex>
+#include <string>
+#include <vector>
+#include "Random.hpp"
+#include "Reference.hpp"
+#include "Tests.hpp"
+#include "fsm/Regex.hpp"
+
+namespace fsmtest {
+
+namespace {
+
+using fsm::Regex;
+
+const std::size_t c_patterns = 1000;
+const std::size_t c_strings = 10;
+
+/// Where an empty path competes with other alternatives or iterations.
+const char *const c_nullable_cases[][2] = {
+    {"(a*|b)b*", "b"},
+    {"(a*|b)b*", "bb"},
+    {"a(|b)b*", "ab"},
+    {"(a|)*b", "ab"},
+    {"(|a)*", "a"},
+    {"(a|)+", "a"},
+    {"(a?)*", "aa"},
+    {"(a*)*", ""},
+    {"(a*)?", ""},
+    {"(a*)+b", "b"},
+    {"(a*)*b", "aab"},
+    {"(a|b*)*", "bb"},
+    {"((a)|b)*", "ab"},
+    {"((a|)b*)*", "abb"},
+    {"(a?)(a*|b)(b?)", "ab"},
+};
+
+void checkCapture(
+    Report &report,
+    Regex &regex,
+    const std::string &pattern,
+    const std::regex &expected,
+    const std::string &str)
+{
+    std::vector<Regex::Span> groups;
+    std::vector<Regex::Span> expected_groups;
+
+    const bool match = regex.capture(str, groups);
+    const bool expected_match =
+        reference::capture(expected, str, expected_groups);
+
+    report.check(
+        match == expected_match &&
+            (!match || equal(groups, expected_groups)),
+        [&]() {
+            return pattern + " on \"" + str + "\":" + toString(groups) +
+                   " instead of" + toString(expected_groups);
+        });
+}
+
+} // namespace
+
+void testCaptures(Report &report)
+{
+    for (const auto &test : c_nullable_cases)
+    {
+        Regex regex(test[0]);
+        checkCapture(report, regex, test[0], std::regex(test[0]), test[1]);
+    }
+
+    Random random(20);
+
+    for (std::size_t i = 0; i < c_patterns; i++)
+    {
+        const std::string pattern = random.pattern(4, 2);
+        const std::regex expected(pattern);
+        Regex regex(pattern);
+
+        for (std::size_t j = 0; j < c_strings; j++)
+        {
+            checkCapture(
+                report, regex, pattern, expected, random.string("ab", 6));
+        }
+    }
+}
+
+} // namespace fsmtest
@@ -0,0 +1,158 @@
+#include <string>
+#include "Random.hpp"
+#include "Tests.hpp"
+#include "fsm/Dfa.hpp"
+#include "fsm/Fsm.hpp"
+#include "fsm/LazyDfa.hpp"
+#include "fsm/Nfa.hpp"
+#include "fsm/Regex.hpp"
+
+namespace fsmtest {
+
+namespace {
+
+using fsm::Fsm;
+
+/// Matches when the n-th symbol from the end is an 'a'. The deterministic
+/// automaton has 2^(n+1) states.
+std::string nthFromEnd(std::size_t n)
+{
+    std::string res = "(a|b)*a";
+
+    for (std::size_t i = 0; i < n; i++)
+    {
+        res += "(a|b)";
+    }
+
+    return res;
+}
+
+bool isNthFromEnd(const std::string &str, std::size_t n)
+{
+    return str.size() > n && str[str.size() - n - 1] == 'a';
+}
+
+} // namespace
+
+void testLazyDfa(Report &report)
+{
+    Random random(6);
+    const std::size_t n = 10;
+    const std::string pattern = nthFromEnd(n);
+    const Fsm nfa = fsm::Regex::buildFsm(pattern);
+    const fsm::Dfa dfa(nfa.min());
+
+    // Room for a few dozen states, far fewer than the input reaches.
+    fsm::LazyDfa lazy(nfa, 64 << 10);
+
+    for (std::size_t i = 0; i < 200; i++)
+    {
+        const std::string str = random.string("ab", 1000);
+        const bool match = lazy.match(str.data(), str.size());
+
+        report.check(
+            match == isNthFromEnd(str, n) &&
+                match == dfa.match(str.data(), str.size()),
+            [&]() { return pattern + " on \"" + str + "\""; });
+    }
+
+    report.check(lazy.getFlushCount() > 0, [&]() {
+        return "no flush of the cache for " + pattern;
+    });
+}
+
+void testNfa(Report &report)
+{
+    Random random(7);
+
+    // Few enough positions for the bit masks, then far too many.
+    for (std::size_t n : {4, 300})
+    {
+        const std::string pattern = nthFromEnd(n);
+        fsm::Nfa nfa(fsm::Regex::buildFsm(pattern));
+
+        report.check(nfa.isBitParallel() == (n < 256), [&]() {
+            return "wrong simulation chosen for " + pattern;
+        });
+
+        for (std::size_t i = 0; i < 200; i++)
+        {
+            const std::string str = random.string("ab", 2 * n);
+
+            report.check(
+                nfa.match(str.data(), str.size()) == isNthFromEnd(str, n),
+                [&]() { return pattern + " on \"" + str + "\""; });
+        }
+    }
+}
+
+/// Inputs large enough for runParallel() to split them, with automata that
+/// keep different states alive across every split.
+void testParallel(Report &report)
+{
+    static const char *const c_patterns[] = {
+        "(a*ba*b)*a*",
+        "((a|b)(a|b)(a|b))*",
+        "(a|b)*a(a|b)(a|b)(a|b)",
+        "(a|ab)*",
+    };
+
+    Random random(10);
+
+    for (const char *pattern : c_patterns)
+    {
+        const fsm::Dfa dfa(fsm::Regex::buildFsm(pattern).min());
+        fsm::Regex regex(pattern);
+
+        for (std::size_t threads : {2, 3, 4})
+        {
+            std::string str;
+
+            while (str.size() < (threads + 1) << 20)
+            {
+                str += random.string("ab", 1 << 10);
+            }
+
+            const char *begin = str.data();
+            const char *end = begin + str.size();
+            const auto start = dfa.getStartingState();
+
+            report.check(
+                dfa.runParallel(start, begin, end, threads) ==
+                        dfa.run(start, begin, end) &&
+                    regex.match(str, threads) == regex.match(str),
+                [&]() {
+                    return std::string(pattern) + " on " +
+                           std::to_string(threads) + " threads";
+                });
+        }
+    }
+
+    // Chunks of a few bytes, so that their boundaries fall inside matches.
+    for (std::size_t i = 0; i < 500; i++)
+    {
+        const std::string pattern = random.pattern(3, 2);
+        const fsm::Dfa dfa(fsm::Regex::buildFsm(pattern).min());
+        const auto start = dfa.getStartingState();
+
+        for (std::size_t j = 0; j < 10; j++)
+        {
+            const std::string str = random.string("abc", 32);
+            const char *begin = str.data();
+            const char *end = begin + str.size();
+            const std::size_t threads = 2 + random.below(7);
+            const std::size_t min_chunk_size = 1 + random.below(4);
+
+            report.check(
+                dfa.runParallel(start, begin, end, threads, min_chunk_size) ==
+                    dfa.run(start, begin, end),
+                [&]() {
+                    return pattern + " on \"" + str + "\" in chunks of " +
+                           std::to_string(min_chunk_size) + " on " +
+                           std::to_string(threads) + " threads";
+                });
+        }
+    }
+}
+
+} // namespace fsmtest
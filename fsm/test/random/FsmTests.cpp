@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+#include "Random.hpp"
+#include "Reference.hpp"
+#include "Tests.hpp"
+#include "fsm/Fsm.hpp"
+#include "fsm/Regex.hpp"
+
+namespace fsmtest {
+
+namespace {
+
+using fsm::Fsm;
+using fsm::Regex;
+
+const std::size_t c_iterations = 2000;
+const std::size_t c_max_states = 8;
+const std::size_t c_max_large_states = 100;
+
+/// Short enough to try every string over the alphabet of Random::fsm().
+const std::size_t c_max_string_size = 6;
+
+bool sameLanguage(
+    const Fsm &fsm1,
+    const Fsm &fsm2,
+    const std::vector<std::string> &strings)
+{
+    for (const std::string &str : strings)
+    {
+        if (reference::accepts(fsm1, str) != reference::accepts(fsm2, str))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// Minimal automata come out numbered the same way, so equal languages
+/// print the same.
+bool sameMinimal(const Fsm &fsm1, const Fsm &fsm2)
+{
+    const Fsm min1 = fsm1.min();
+    const Fsm min2 = fsm2.min();
+
+    return toString(min1) == toString(min2) &&
+           min1.getFinalStates() == min2.getFinalStates();
+}
+
+/// Whether @p str is made of one or more parts accepted by @p fsm.
+bool acceptsIteration(const Fsm &fsm, const std::string &str)
+{
+    for (std::size_t i = 1; i < str.size(); i++)
+    {
+        if (reference::accepts(fsm, str.substr(0, i)) &&
+            acceptsIteration(fsm, str.substr(i)))
+        {
+            return true;
+        }
+    }
+
+    return reference::accepts(fsm, str);
+}
+
+} // namespace
+
+void testAutomata(Report &report)
+{
+    Random random(1);
+    const auto strings = reference::strings("ab", c_max_string_size);
+
+    for (std::size_t i = 0; i < c_iterations; i++)
+    {
+        const Fsm nfa = random.fsm(c_max_states);
+        const Fsm rev = nfa.rev();
+        const Fsm dfa = nfa.det();
+        const Fsm min = nfa.min();
+        bool reversed = true;
+
+        for (std::string str : strings)
+        {
+            const bool accepted = reference::accepts(nfa, str);
+            std::reverse(str.begin(), str.end());
+            reversed = reversed && reference::accepts(rev, str) == accepted;
+        }
+
+        report.check(reversed, [&]() { return "rev() of\n" + toString(nfa); });
+
+        report.check(
+            dfa.isDeterministic() && sameLanguage(nfa, dfa, strings),
+            [&]() { return "det() of\n" + toString(nfa); });
+
+        report.check(
+            min.isDeterministic() && sameLanguage(nfa, min, strings) &&
+                min.getTransitions().size() <= dfa.getTransitions().size(),
+            [&]() { return "min() of\n" + toString(nfa); });
+    }
+}
+
+void testDeterminization(Report &report)
+{
+    Random random(2);
+
+    for (std::size_t i = 0; i < c_iterations; i++)
+    {
+        const Fsm nfa = random.fsm(c_max_states);
+        const Fsm dfa = nfa.det();
+
+        // Every subset of a deterministic automaton is a single state, met
+        // once, so determinizing it again changes nothing.
+        report.check(toString(dfa.det()) == toString(dfa), [&]() {
+            return "det() of the deterministic\n" + toString(dfa);
+        });
+    }
+
+    // State sets of more than one word.
+    for (std::size_t i = 0; i < c_iterations / 10; i++)
+    {
+        const Fsm nfa = random.fsm(c_max_large_states);
+        const Fsm dfa = nfa.det();
+        std::vector<std::string> strings;
+
+        for (std::size_t j = 0; j < 20; j++)
+        {
+            strings.push_back(random.string("ab", 12));
+        }
+
+        report.check(
+            dfa.isDeterministic() && sameLanguage(nfa, dfa, strings),
+            [&]() { return "det() of\n" + toString(nfa); });
+    }
+
+    // The n-th symbol from the end is an 'a': the subsets to tell apart
+    // double with n.
+    std::string pattern = "(a|b)*a";
+
+    for (std::size_t n = 0; n < 10; n++)
+    {
+        const Fsm dfa = Regex::buildFsm(pattern).det();
+        bool ok = true;
+
+        for (std::size_t j = 0; j < 100; j++)
+        {
+            const std::string str = random.string("ab", 20);
+            const bool expected =
+                str.size() > n && str[str.size() - n - 1] == 'a';
+
+            ok = ok && reference::accepts(dfa, str) == expected;
+        }
+
+        report.check(
+            ok && dfa.min().getTransitions().size() == std::size_t{2} << n,
+            [&]() { return "det() of " + pattern; });
+
+        pattern += "(a|b)";
+    }
+
+    // Enough subsets for det() to expand them on several threads, which must
+    // not change how they are numbered.
+    const Fsm nfa = Regex::buildFsm(pattern);
+    std::vector<std::set<Fsm::state_t>> final_states1;
+    std::vector<std::set<Fsm::state_t>> final_states4;
+
+    report.check(
+        toString(nfa.det(final_states1, 1)) ==
+                toString(nfa.det(final_states4, 4)) &&
+            final_states1 == final_states4,
+        [&]() { return "det(4) differs from det(1) for " + pattern; });
+
+    // Without the final states of the subsets the result is the same.
+    const Fsm dfa = nfa.det(4);
+    bool finals_match = final_states1.size() == dfa.getTransitions().size();
+
+    for (std::size_t i = 0; finals_match && i < final_states1.size(); i++)
+    {
+        finals_match = final_states1[i].empty() !=
+                       (dfa.getFinalStates().count(i) > 0);
+    }
+
+    report.check(
+        toString(dfa) == toString(nfa.det(final_states1, 1)) && finals_match,
+        [&]() { return "det() without final states for " + pattern; });
+}
+
+void testMinimization(Report &report)
+{
+    Random random(3);
+    const auto strings = reference::strings("ab", c_max_string_size);
+
+    for (std::size_t i = 0; i < c_iterations; i++)
+    {
+        const Fsm nfa = random.fsm(c_max_states);
+        const Fsm brzozowski = nfa.min(Fsm::Minimization::Brzozowski);
+        const Fsm hopcroft = nfa.min(Fsm::Minimization::Hopcroft);
+
+        report.check(
+            toString(brzozowski) == toString(hopcroft) &&
+                toString(hopcroft) == toString(nfa.det().min()) &&
+                sameLanguage(nfa, hopcroft, strings),
+            [&]() { return "min() of\n" + toString(nfa); });
+    }
+}
+
+/// Epsilon cycles through several states, which Random::fsm() leaves out.
+void testClosures(Report &report)
+{
+    Random random(4);
+    const auto strings = reference::strings("ab", c_max_string_size);
+
+    for (std::size_t i = 0; i < c_iterations; i++)
+    {
+        Fsm nfa = random.fsm(c_max_states);
+        const std::size_t states = nfa.getTransitions().size();
+
+        for (std::size_t j = random.below(2 * states); j > 0; j--)
+        {
+            nfa.connect(random.below(states), random.below(states), '\0');
+        }
+
+        const Fsm dfa = nfa.det();
+
+        report.check(
+            dfa.isDeterministic() && sameLanguage(nfa, dfa, strings) &&
+                toString(nfa.min()) == toString(dfa.min()),
+            [&]() { return "closures of\n" + toString(nfa); });
+    }
+}
+
+void testProducts(Report &report)
+{
+    Random random(12);
+    const auto strings = reference::strings("ab", c_max_string_size);
+
+    for (std::size_t i = 0; i < c_iterations; i++)
+    {
+        const Fsm fsm1 = random.fsm(c_max_states);
+        const Fsm fsm2 = random.fsm(c_max_states);
+
+        const Fsm intersection = Fsm::intersection(fsm1, fsm2);
+        const Fsm difference = Fsm::difference(fsm1, fsm2);
+        const Fsm complement = Fsm::complement(fsm1);
+        bool ok = true;
+        std::string failed;
+
+        for (const std::string &str : strings)
+        {
+            const bool in1 = reference::accepts(fsm1, str);
+            const bool in2 = reference::accepts(fsm2, str);
+
+            if (reference::accepts(intersection, str) != (in1 && in2) ||
+                reference::accepts(difference, str) != (in1 && !in2) ||
+                reference::accepts(complement, str) == in1)
+            {
+                ok = false;
+                failed = str;
+                break;
+            }
+        }
+
+        report.check(ok, [&]() {
+            return "products on \"" + failed + "\" of\n" + toString(fsm1) +
+                   "and\n" + toString(fsm2);
+        });
+    }
+}
+
+void testEquivalence(Report &report)
+{
+    Random random(13);
+
+    for (std::size_t i = 0; i < c_iterations; i++)
+    {
+        const Fsm fsm1 = random.fsm(c_max_states);
+        const Fsm fsm2 = random.fsm(c_max_states);
+        auto describe = [&]() {
+            return "operands\n" + toString(fsm1) + "and\n" + toString(fsm2);
+        };
+
+        std::string counterexample;
+        const bool equivalent =
+            Fsm::equivalent(fsm1, fsm2, counterexample);
+
+        report.check(
+            equivalent == sameMinimal(fsm1, fsm2) &&
+                (equivalent ||
+                 reference::accepts(fsm1, counterexample) !=
+                     reference::accepts(fsm2, counterexample)),
+            [&]() { return "equivalent() of " + describe(); });
+
+        const bool includes = Fsm::includes(fsm1, fsm2, counterexample);
+        const Fsm excess = Fsm::difference(fsm2, fsm1).min();
+
+        report.check(
+            includes == excess.getFinalStates().empty() &&
+                (includes ||
+                 (reference::accepts(fsm2, counterexample) &&
+                  !reference::accepts(fsm1, counterexample))),
+            [&]() { return "includes() of " + describe(); });
+
+        report.check(
+            Fsm::equivalent(fsm1, fsm1.min()) &&
+                Fsm::includes(fsm1, Fsm::intersection(fsm1, fsm2)),
+            [&]() { return "equivalent() to a part of " + describe(); });
+    }
+}
+
+/// The combinators taking rvalues against the ones that copy their operands.
+void testCombinators(Report &report)
+{
+    Random random(14);
+    const auto strings = reference::strings("abc", 4);
+
+    for (std::size_t i = 0; i < c_iterations / 10; i++)
+    {
+        // Thompson's construction gives the fragments that the combinators
+        // expect: one starting state and one final state, neither on a cycle.
+        const std::string pattern1 = random.pattern(3, 1);
+        const std::string pattern2 = random.pattern(3, 1);
+        const Fsm fsm1 =
+            Regex::buildFsm(pattern1, Regex::Construction::Thompson);
+        const Fsm fsm2 =
+            Regex::buildFsm(pattern2, Regex::Construction::Thompson);
+        const std::vector<Fsm> fsms{fsm1, fsm2};
+        auto describe = [&]() { return pattern1 + " and " + pattern2; };
+
+        const Fsm concatenation = Fsm::concatenation(fsms);
+        const Fsm disjunction = Fsm::disjunction(fsms);
+        const Fsm option = Fsm::option(fsm1);
+        const Fsm iteration = Fsm::iteration(fsm1);
+
+        report.check(
+            toString(concatenation) ==
+                    toString(Fsm::concatenation(std::vector<Fsm>(fsms))) &&
+                toString(disjunction) ==
+                    toString(Fsm::disjunction(std::vector<Fsm>(fsms))) &&
+                toString(option) == toString(Fsm::option(Fsm(fsm1))) &&
+                toString(iteration) == toString(Fsm::iteration(Fsm(fsm1))),
+            [&]() { return "moved " + describe(); });
+
+        bool ok = true;
+        std::string failed;
+
+        for (const std::string &str : strings)
+        {
+            const bool in1 = reference::accepts(fsm1, str);
+            bool concatenated = false;
+
+            for (std::size_t j = 0; j <= str.size() && !concatenated; j++)
+            {
+                concatenated =
+                    reference::accepts(fsm1, str.substr(0, j)) &&
+                    reference::accepts(fsm2, str.substr(j));
+            }
+
+            if (reference::accepts(concatenation, str) != concatenated ||
+                reference::accepts(disjunction, str) !=
+                    (in1 || reference::accepts(fsm2, str)) ||
+                reference::accepts(option, str) != (in1 || str.empty()) ||
+                reference::accepts(iteration, str) !=
+                    acceptsIteration(fsm1, str))
+            {
+                ok = false;
+                failed = str;
+                break;
+            }
+        }
+
+        report.check(ok, [&]() {
+            return "combinators on \"" + failed + "\" of " + describe();
+        });
+    }
+}
+
+} // namespace fsmtest
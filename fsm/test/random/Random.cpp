@@ -0,0 +1,132 @@
+#include "Random.hpp"
+#include <algorithm>
+
+namespace fsmtest {
+
+Random::Random(unsigned seed)
+    : m_engine{seed}
+{
+}
+
+std::size_t Random::below(std::size_t n)
+{
+    return std::uniform_int_distribution<std::size_t>(0, n - 1)(m_engine);
+}
+
+fsm::Fsm Random::fsm(std::size_t max_states)
+{
+    const std::size_t states = 1 + below(max_states);
+    fsm::Fsm res(states);
+
+    res.setStarting(below(states));
+
+    if (below(2))
+    {
+        res.setStarting(below(states));
+    }
+
+    for (std::size_t s = 0; s < states; s++)
+    {
+        if (!below(3))
+        {
+            res.setFinal(s);
+        }
+    }
+
+    for (std::size_t i = below(3 * states); i > 0; i--)
+    {
+        const std::size_t s1 = below(states);
+        const std::size_t s2 = below(states);
+        const std::size_t label = below(4);
+
+        if (label == 0)
+        {
+            res.connect(std::min(s1, s2), std::max(s1, s2), '\0');
+            continue;
+        }
+
+        if (label == 3)
+        {
+            res.connect(s1, s2, 'a', 'b');
+            continue;
+        }
+
+        res.connect(s1, s2, "ab"[label - 1]);
+    }
+
+    return res;
+}
+
+std::string Random::pattern(std::size_t max_depth, std::size_t max_loops)
+{
+    return subpattern(0, max_depth, 0, max_loops);
+}
+
+std::string Random::string(const std::string &alphabet, std::size_t max_size)
+{
+    std::string res(below(max_size + 1), '\0');
+
+    for (char &c : res)
+    {
+        c = alphabet[below(alphabet.size())];
+    }
+
+    return res;
+}
+
+std::string Random::atom()
+{
+    static const char *const c_sets[] = {"[ab]", "[a-c]", "[bc]", "."};
+
+    if (below(4))
+    {
+        return std::string(1, "abc"[below(3)]);
+    }
+
+    return c_sets[below(4)];
+}
+
+/// Alternations always get parentheses, which the grammar requires at the
+/// top level.
+std::string Random::subpattern(
+    std::size_t depth,
+    std::size_t max_depth,
+    std::size_t loops,
+    std::size_t max_loops)
+{
+    static const char *const c_quantifiers[] = {"*", "+", "?"};
+
+    if (depth >= max_depth)
+    {
+        return atom();
+    }
+
+    auto next = [&]() {
+        return subpattern(depth + 1, max_depth, loops, max_loops);
+    };
+
+    switch (below(loops < max_loops ? 6 : 5))
+    {
+    case 0:
+        return atom();
+
+    case 1:
+        return "(" + next() + ")";
+
+    case 2:
+        return "(" + next() + "|" + next() + ")";
+
+    case 3:
+        return next() + next();
+
+    case 4:
+        return below(2) ? "(|" + next() + ")" : "(" + next() + "|)";
+
+    default:
+        return "(" +
+               subpattern(depth + 1, max_depth, loops + 1, max_loops) +
+               ")" + c_quantifiers[below(3)];
+    }
+}
+
+} // namespace fsmtest
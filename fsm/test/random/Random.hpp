@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include "fsm/Fsm.hpp"
+
+namespace fsmtest {
+
+/// Source of random automata, patterns and strings. Every test seeds its own,
+/// so a run checks the same cases each time.
+class Random final
+{
+public: // methods
+    explicit Random(unsigned seed);
+
+    /// Uniform in [0, n).
+    std::size_t below(std::size_t n);
+
+    /// Automaton over 'a' and 'b', with edges labelled with either or both,
+    /// and any number of starting and final states. Epsilon edges never lead
+    /// to a lower state, so they form no cycles other than loops.
+    fsm::Fsm fsm(std::size_t max_states);
+
+    /// Pattern over 'a', 'b' and 'c' that std::regex reads the same way,
+    /// with empty alternatives and with iterations nested at most
+    /// @p max_loops deep. Beyond two, std::regex may backtrack for ages.
+    std::string pattern(std::size_t max_depth, std::size_t max_loops);
+
+    std::string string(const std::string &alphabet, std::size_t max_size);
+
+private: // methods
+    std::string atom();
+
+    std::string subpattern(
+        std::size_t depth,
+        std::size_t max_depth,
+        std::size_t loops,
+        std::size_t max_loops);
+
+private: // fields
+    std::mt19937 m_engine;
+};
+
+} // namespace fsmtest
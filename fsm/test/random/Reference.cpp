@@ -0,0 +1,203 @@
+#include "Reference.hpp"
+#include <set>
+#include <sstream>
+
+namespace fsmtest {
+
+namespace reference {
+
+namespace {
+
+using Transitions = std::vector<std::vector<fsm::Fsm::Transition>>;
+
+void close(const Transitions &transitions, std::set<fsm::Fsm::state_t> &states)
+{
+    std::vector<fsm::Fsm::state_t> stack(states.begin(), states.end());
+
+    while (!stack.empty())
+    {
+        const fsm::Fsm::state_t s = stack.back();
+        stack.pop_back();
+
+        for (const fsm::Fsm::Transition &tr : transitions[s])
+        {
+            if (tr.isEpsilon() && states.insert(tr.state).second)
+            {
+                stack.push_back(tr.state);
+            }
+        }
+    }
+}
+
+} // namespace
+
+bool accepts(const fsm::Fsm &fsm, const std::string &str)
+{
+    const Transitions &transitions = fsm.getTransitions();
+    std::set<fsm::Fsm::state_t> states = fsm.getStartingStates();
+    close(transitions, states);
+
+    for (char c : str)
+    {
+        std::set<fsm::Fsm::state_t> next;
+
+        for (fsm::Fsm::state_t s : states)
+        {
+            for (const fsm::Fsm::Transition &tr : transitions[s])
+            {
+                if (!tr.isEpsilon() && tr.contains(c))
+                {
+                    next.insert(tr.state);
+                }
+            }
+        }
+
+        close(transitions, next);
+        states = std::move(next);
+    }
+
+    for (fsm::Fsm::state_t s : states)
+    {
+        if (fsm.getFinalStates().count(s))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::vector<std::string> strings(
+    const std::string &alphabet,
+    std::size_t max_size)
+{
+    std::vector<std::string> res{""};
+
+    for (std::size_t i = 0; i < res.size(); i++)
+    {
+        if (res[i].size() < max_size)
+        {
+            for (char c : alphabet)
+            {
+                res.push_back(res[i] + c);
+            }
+        }
+    }
+
+    return res;
+}
+
+std::vector<fsm::Regex::Span> findAll(
+    const std::regex &regex,
+    const std::string &str)
+{
+    std::vector<fsm::Regex::Span> res;
+    std::size_t begin = 0;
+
+    while (begin <= str.size())
+    {
+        std::size_t end = str.size();
+        bool found = false;
+
+        for (;; end--)
+        {
+            found = std::regex_match(
+                str.begin() + begin, str.begin() + end, regex);
+
+            if (found || end == begin)
+            {
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            begin++;
+            continue;
+        }
+
+        res.push_back({begin, end});
+        begin = end > begin ? end : begin + 1;
+    }
+
+    return res;
+}
+
+bool capture(
+    const std::regex &regex,
+    const std::string &str,
+    std::vector<fsm::Regex::Span> &groups)
+{
+    std::smatch match;
+
+    if (!std::regex_match(str, match, regex))
+    {
+        return false;
+    }
+
+    groups.clear();
+
+    for (std::size_t i = 0; i < match.size(); i++)
+    {
+        if (!match[i].matched)
+        {
+            groups.push_back({std::string::npos, std::string::npos});
+            continue;
+        }
+
+        const std::size_t begin = match.position(i);
+        groups.push_back({begin, begin + match.length(i)});
+    }
+
+    return true;
+}
+
+} // namespace reference
+
+bool equal(
+    const std::vector<fsm::Regex::Span> &spans1,
+    const std::vector<fsm::Regex::Span> &spans2)
+{
+    if (spans1.size() != spans2.size())
+    {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < spans1.size(); i++)
+    {
+        if (spans1[i].begin != spans2[i].begin ||
+            spans1[i].end != spans2[i].end)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string toString(const fsm::Fsm &fsm)
+{
+    std::ostringstream stream;
+    stream << fsm;
+    return stream.str();
+}
+
+std::string toString(const std::vector<fsm::Regex::Span> &spans)
+{
+    std::ostringstream stream;
+
+    for (const fsm::Regex::Span &span : spans)
+    {
+        if (span.begin == std::string::npos)
+        {
+            stream << " -";
+            continue;
+        }
+
+        stream << " [" << span.begin << ", " << span.end << ")";
+    }
+
+    return stream.str();
+}
+
+} // namespace fsmtest
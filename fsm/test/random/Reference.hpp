@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <regex>
+#include <string>
+#include <vector>
+#include "fsm/Fsm.hpp"
+#include "fsm/Regex.hpp"
+
+namespace fsmtest {
+
+/// Simple and slow versions of what the library does, to check it against.
+namespace reference {
+
+/// Whether @p fsm accepts @p str, following the epsilon edges by hand.
+bool accepts(const fsm::Fsm &fsm, const std::string &str);
+
+/// Every string over @p alphabet of at most @p max_size symbols.
+std::vector<std::string> strings(
+    const std::string &alphabet,
+    std::size_t max_size);
+
+/// Leftmost-longest matches like Regex::findAll(), trying std::regex on
+/// every substring.
+std::vector<fsm::Regex::Span> findAll(
+    const std::regex &regex,
+    const std::string &str);
+
+/// Groups like Regex::capture(), from std::regex.
+bool capture(
+    const std::regex &regex,
+    const std::string &str,
+    std::vector<fsm::Regex::Span> &groups);
+
+} // namespace reference
+
+bool equal(
+    const std::vector<fsm::Regex::Span> &spans1,
+    const std::vector<fsm::Regex::Span> &spans2);
+
+std::string toString(const fsm::Fsm &fsm);
+std::string toString(const std::vector<fsm::Regex::Span> &spans);
+
+} // namespace fsmtest
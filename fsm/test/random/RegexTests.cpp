@@ -0,0 +1,577 @@
+#include <algorithm>
+#include <cstdint>
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Random.hpp"
+#include "Reference.hpp"
+#include "Tests.hpp"
+#include "fsm/Fsm.hpp"
+#include "fsm/LiteralFinder.hpp"
+#include "fsm/Regex.hpp"
+#include "fsm/RegexSet.hpp"
+#include "fsm/Stream.hpp"
+
+namespace fsmtest {
+
+namespace {
+
+using fsm::Regex;
+
+const std::size_t c_max_loops = 2;
+
+const std::size_t c_patterns = 500;
+const std::size_t c_strings = 10;
+
+struct Engine
+{
+    Regex::Engine engine;
+    const char *name;
+};
+
+const Engine c_engines[] = {
+    {Regex::Engine::Dfa, "dfa"},
+    {Regex::Engine::LazyDfa, "lazy dfa"},
+    {Regex::Engine::Nfa, "nfa"},
+};
+
+/// Every engine against std::regex on random strings over @p alphabet.
+void checkEngines(
+    Report &report,
+    Random &random,
+    const std::string &pattern,
+    const std::string &alphabet)
+{
+    const std::regex expected(pattern);
+
+    for (const Engine &engine : c_engines)
+    {
+        Regex regex(pattern, engine.engine);
+
+        for (std::size_t j = 0; j < c_strings; j++)
+        {
+            const std::string str = random.string(alphabet, 8);
+
+            report.check(
+                regex.match(str) == std::regex_match(str, expected), [&]() {
+                    return std::string(engine.name) + " " + pattern +
+                           " on \"" + str + "\"";
+                });
+        }
+    }
+}
+
+/// find() and findAll() of one engine against the reference.
+void checkSearch(
+    Report &report,
+    const Engine &engine,
+    const std::string &pattern,
+    const std::vector<std::string> &strings)
+{
+    const std::regex expected(pattern);
+    Regex regex(pattern, engine.engine);
+
+    for (const std::string &str : strings)
+    {
+        const auto spans = reference::findAll(expected, str);
+        const auto found = regex.findAll(str);
+
+        Regex::Span span;
+        const bool first = regex.find(str, span);
+
+        report.check(
+            equal(found, spans) && first == !spans.empty() &&
+                (!first || equal({span}, {spans[0]})),
+            [&]() {
+                return std::string(engine.name) + " " + pattern + " on \"" +
+                       str + "\":" + toString(found) + " instead of" +
+                       toString(spans);
+            });
+    }
+}
+
+void checkSearch(
+    Report &report,
+    const std::string &pattern,
+    const std::vector<std::string> &strings)
+{
+    for (const Engine &engine : c_engines)
+    {
+        checkSearch(report, engine, pattern, strings);
+    }
+}
+
+} // namespace
+
+void testMatching(Report &report)
+{
+    Random random(5);
+
+    for (std::size_t i = 0; i < c_patterns; i++)
+    {
+        const std::string pattern = random.pattern(4, c_max_loops);
+        const fsm::Fsm glushkov =
+            Regex::buildFsm(pattern, Regex::Construction::Glushkov);
+        bool epsilon_free = true;
+
+        for (const auto &transitions : glushkov.getTransitions())
+        {
+            for (const fsm::Fsm::Transition &tr : transitions)
+            {
+                epsilon_free = epsilon_free && !tr.isEpsilon();
+            }
+        }
+
+        report.check(
+            epsilon_free &&
+                fsm::Fsm::equivalent(
+                    glushkov,
+                    Regex::buildFsm(pattern, Regex::Construction::Thompson)),
+            [&]() { return "constructions of " + pattern; });
+
+        checkEngines(report, random, pattern, "abc");
+    }
+}
+
+void testRegexSet(Report &report)
+{
+    Random random(8);
+
+    for (std::size_t i = 0; i < c_patterns / 5; i++)
+    {
+        std::vector<std::string> patterns;
+        std::vector<std::regex> expected;
+
+        for (std::size_t j = 1 + random.below(6); j > 0; j--)
+        {
+            patterns.push_back(random.pattern(3, c_max_loops));
+            expected.emplace_back(patterns.back());
+        }
+
+        const fsm::RegexSet set(patterns);
+
+        for (std::size_t j = 0; j < c_strings; j++)
+        {
+            const std::string str = random.string("abc", 8);
+            std::vector<std::size_t> ids;
+
+            for (std::size_t id = 0; id < expected.size(); id++)
+            {
+                if (std::regex_match(str, expected[id]))
+                {
+                    ids.push_back(id);
+                }
+            }
+
+            report.check(
+                set.size() == patterns.size() && set.match(str) == ids &&
+                    set.matchAny(str) == !ids.empty(),
+                [&]() {
+                    std::string res = "set of";
+
+                    for (const std::string &pattern : patterns)
+                    {
+                        res += " " + pattern;
+                    }
+
+                    return res + " on \"" + str + "\"";
+                });
+        }
+    }
+}
+
+/// Feeds every string twice, in random chunks and with a reset() between.
+void testStream(Report &report)
+{
+    Random random(9);
+
+    for (std::size_t i = 0; i < c_patterns; i++)
+    {
+        const std::string pattern = random.pattern(3, c_max_loops);
+        const std::regex expected(pattern);
+        const Regex regex(pattern);
+
+        for (std::size_t j = 0; j < c_strings; j++)
+        {
+            const std::string str = random.string("abc", 12);
+            std::vector<std::uint64_t> ends;
+            std::vector<std::uint64_t> expected_ends;
+
+            fsm::Stream stream = regex.stream(
+                [&](std::uint64_t end) { ends.push_back(end); });
+
+            for (std::size_t pass = 0; pass < 2; pass++)
+            {
+                for (std::size_t end = 0; end <= str.size(); end++)
+                {
+                    if (std::regex_match(
+                            str.begin(), str.begin() + end, expected))
+                    {
+                        expected_ends.push_back(pass * str.size() + end);
+                    }
+                }
+
+                if (pass)
+                {
+                    stream.reset();
+                }
+
+                for (std::size_t begin = 0; begin < str.size();)
+                {
+                    const std::size_t size = std::min(
+                        random.below(4), str.size() - begin);
+
+                    stream.feed(str.data() + begin, size);
+                    begin += size;
+                }
+            }
+
+            report.check(
+                ends == expected_ends &&
+                    stream.isMatch() == std::regex_match(str, expected) &&
+                    stream.getOffset() == 2 * str.size(),
+                [&]() { return pattern + " on \"" + str + "\""; });
+        }
+    }
+
+    // The stream is anchored at its start, unless the pattern begins with .*
+    const std::string str = "abcab";
+
+    for (const char *pattern : {"ab", ".*ab"})
+    {
+        std::vector<std::uint64_t> ends;
+        const std::vector<std::uint64_t> expected_ends =
+            pattern[0] == '.' ? std::vector<std::uint64_t>{2, 5}
+                              : std::vector<std::uint64_t>{2};
+
+        const Regex regex(pattern);
+        fsm::Stream stream = regex.stream(
+            [&](std::uint64_t end) { ends.push_back(end); });
+        stream.feed(str.data(), str.size());
+
+        report.check(ends == expected_ends, [&]() {
+            return std::string(pattern) + " on \"" + str + "\"";
+        });
+    }
+}
+
+/// Bytes share a class exactly when they lead from every state to the same
+/// states.
+void testByteClasses(Report &report)
+{
+    Random random(11);
+
+    for (std::size_t i = 0; i < c_patterns; i++)
+    {
+        const std::string pattern = random.pattern(3, c_max_loops);
+        const fsm::Fsm fsm = Regex::buildFsm(pattern);
+        const fsm::ByteClasses classes = fsm.getByteClasses();
+        std::vector<std::vector<std::pair<std::size_t, std::size_t>>>
+            signatures(256);
+
+        for (std::size_t s = 0; s < fsm.getTransitions().size(); s++)
+        {
+            for (const fsm::Fsm::Transition &tr : fsm.getTransitions()[s])
+            {
+                for (std::size_t b = 1; b < 256 && !tr.isEpsilon(); b++)
+                {
+                    if (tr.contains(static_cast<char>(b)))
+                    {
+                        signatures[b].emplace_back(s, tr.state);
+                    }
+                }
+            }
+        }
+
+        for (auto &signature : signatures)
+        {
+            std::sort(signature.begin(), signature.end());
+            signature.erase(
+                std::unique(signature.begin(), signature.end()),
+                signature.end());
+        }
+
+        bool ok = true;
+
+        for (std::size_t b = 0; b < 256; b++)
+        {
+            const unsigned char r = classes.getRepresentative(classes[b]);
+            ok = ok && r <= b && signatures[r] == signatures[b];
+        }
+
+        for (std::size_t c1 = 0; c1 < classes.size(); c1++)
+        {
+            for (std::size_t c2 = 0; c2 < c1; c2++)
+            {
+                ok = ok && signatures[classes.getRepresentative(c1)] !=
+                               signatures[classes.getRepresentative(c2)];
+            }
+        }
+
+        report.check(ok, [&]() { return "byte classes of " + pattern; });
+
+        // Bytes outside of the pattern all fall into class 0.
+        checkEngines(report, random, pattern, "abcd\xff");
+    }
+}
+
+/// Patterns nested or long enough to overflow the stack of a recursive
+/// parser or compiler.
+void testDeepPatterns(Report &report)
+{
+    const std::size_t depth = 100000;
+    std::string parentheses = std::string(depth, '(') + "a";
+    std::string iterations = parentheses;
+    std::string alternations;
+    std::string literal;
+
+    for (std::size_t i = 0; i < depth; i++)
+    {
+        parentheses += ")";
+        iterations += ")*";
+        literal += "ab"[i % 3 % 2];
+    }
+
+    // Every alternative adds states, so these stay shallower.
+    for (std::size_t i = 0; i < depth / 10; i++)
+    {
+        alternations += "(b|";
+    }
+
+    alternations += "a" + std::string(depth / 10, ')');
+
+    struct Case
+    {
+        const std::string &pattern;
+        const char *name;
+        std::vector<std::string> matching;
+        std::vector<std::string> failing;
+    };
+
+    std::string mismatch = literal;
+    mismatch.back() = 'c';
+
+    const Case cases[] = {
+        {parentheses, "parentheses", {"a"}, {"", "aa"}},
+        {iterations, "iterations", {"", "a", "aaa"}, {"b", "ab"}},
+        {alternations, "alternations", {"a", "b"}, {"", "ab", "c"}},
+        {literal, "literal", {literal}, {"", mismatch, literal + "a"}},
+    };
+
+    for (const Case &test : cases)
+    {
+        Regex regex(test.pattern);
+        bool ok = true;
+
+        for (const std::string &str : test.matching)
+        {
+            ok = ok && regex.match(str);
+        }
+
+        for (const std::string &str : test.failing)
+        {
+            ok = ok && !regex.match(str);
+        }
+
+        report.check(ok, [&]() { return std::string(test.name); });
+    }
+
+    // Every parenthesis is also a group for capture().
+    Regex regex(parentheses);
+    std::vector<Regex::Span> groups;
+    bool ok = regex.capture("a", groups) && groups.size() == depth + 1;
+
+    for (const Regex::Span &span : groups)
+    {
+        ok = ok && span.begin == 0 && span.end == 1;
+    }
+
+    report.check(ok, []() { return "captures of parentheses"; });
+}
+
+/// Patterns shaped for the rewrites of the AST optimizer: alternatives with
+/// common prefixes, nested quantifiers and repeated subtrees.
+void testOptimizer(Report &report)
+{
+    Random random(17);
+    const char *const quantifiers[] = {"*", "+", "?"};
+
+    // Regex keeps the captures of these groups, which the optimizer folds
+    // into their parent. An empty group matches nothing, unlike in
+    // std::regex, so buildFsm() without captures is the reference.
+    for (const char *pattern : {"a(())b", "(a(()b))c", "((a)(()))*", "(()|a)b"})
+    {
+        const fsm::Fsm fsm = Regex::buildFsm(pattern);
+
+        for (const Engine &engine : c_engines)
+        {
+            Regex regex(pattern, engine.engine);
+
+            for (const std::string &str : reference::strings("abc", 4))
+            {
+                report.check(
+                    regex.match(str) == reference::accepts(fsm, str), [&]() {
+                        return std::string(engine.name) + " " + pattern +
+                               " on \"" + str + "\"";
+                    });
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < c_patterns; i++)
+    {
+        const std::string prefix = random.string("abc", 2);
+        const std::string x = random.pattern(2, 1);
+        const std::string y = random.pattern(2, 1);
+        // std::regex backtracks for ages on nested loops over empty strings.
+        const std::string word = prefix + "abc"[random.below(3)];
+        const char *q1 = quantifiers[random.below(3)];
+        const char *q2 = quantifiers[random.below(3)];
+
+        const std::string patterns[] = {
+            "(" + prefix + x + "|" + prefix + y + "|" + prefix + ")",
+            "((" + word + ")" + q1 + ")" + q2,
+            "(" + x + "|" + x + ")" + x,
+            "(a|" + prefix + "|[bc]|.)" + q1,
+        };
+
+        for (const std::string &pattern : patterns)
+        {
+            checkEngines(report, random, pattern, "abc");
+        }
+    }
+}
+
+void testPrefilter(Report &report)
+{
+    Random random(18);
+
+    for (std::size_t i = 0; i < c_patterns; i++)
+    {
+        const std::string literal = random.string("abc", 3);
+        const std::string pattern =
+            random.pattern(2, 1) + literal + random.pattern(2, 1);
+        const std::string required = Regex::requiredLiteral(pattern);
+        const std::regex expected(pattern);
+        Regex regex(pattern);
+        std::string literal_of_fsm;
+
+        report.check(
+            toString(Regex::buildFsm(pattern, literal_of_fsm)) ==
+                    toString(Regex::buildFsm(pattern)) &&
+                literal_of_fsm == required,
+            [&]() { return "buildFsm() with the literal of " + pattern; });
+        std::vector<std::string> strings;
+
+        for (std::size_t j = 0; j < c_strings; j++)
+        {
+            std::string str = random.string("abc", 10);
+
+            if (j % 2)
+            {
+                str.insert(random.below(str.size() + 1), literal);
+            }
+
+            strings.push_back(str);
+
+            const bool match = std::regex_match(str, expected);
+
+            report.check(
+                !match || str.find(required) != std::string::npos, [&]() {
+                    return "required literal \"" + required + "\" of " +
+                           pattern + " not in \"" + str + "\"";
+                });
+
+            report.check(regex.match(str) == match, [&]() {
+                return pattern + " on \"" + str + "\"";
+            });
+        }
+
+        // Skipping to the literal must not lose matches.
+        checkSearch(report, pattern, strings);
+    }
+
+    // Long enough for the 16 byte steps of LiteralFinder.
+    for (std::size_t i = 0; i < c_patterns * c_strings; i++)
+    {
+        const std::string literal = random.string("abc", 4);
+        const std::string str = random.string("abc", 64);
+        const fsm::LiteralFinder finder(literal);
+        const std::size_t found = str.find(literal);
+        const char *position =
+            finder.find(str.data(), str.data() + str.size());
+
+        report.check(
+            found == std::string::npos ? !position
+                                       : position == str.data() + found,
+            [&]() {
+                return "LiteralFinder of \"" + literal + "\" in \"" + str +
+                       "\"";
+            });
+    }
+}
+
+void testSearch(Report &report)
+{
+    Random random(19);
+
+    for (std::size_t i = 0; i < c_patterns; i++)
+    {
+        const std::string pattern = random.pattern(3, c_max_loops);
+        std::vector<std::string> strings;
+
+        for (std::size_t j = 0; j < c_strings; j++)
+        {
+            strings.push_back(random.string("abc", 8));
+        }
+
+        checkSearch(report, pattern, strings);
+    }
+
+    // Every run from a match start would rescan the rest of the input, if
+    // runs did not stop where an earlier one failed.
+    const std::string str(100000, 'a');
+
+    for (const Engine &engine : c_engines)
+    {
+        Regex regex("(a.*b|a)", engine.engine);
+        const auto spans = regex.findAll(str);
+        bool ok = spans.size() == str.size();
+
+        for (std::size_t i = 0; ok && i < spans.size(); i++)
+        {
+            ok = spans[i].begin == i && spans[i].end == i + 1;
+        }
+
+        report.check(ok, [&]() {
+            return std::string(engine.name) + " findAll() on a long input";
+        });
+    }
+
+    // The minimal DFA has over a million states, so only lazy DFAs can
+    // search it.
+    std::string pattern = "(a|b)*a";
+
+    for (std::size_t i = 0; i < 20; i++)
+    {
+        pattern += "(a|b)";
+    }
+
+    std::vector<std::string> strings;
+
+    for (std::size_t i = 0; i < c_strings; i++)
+    {
+        strings.push_back(random.string("ab", 30));
+    }
+
+    for (const Engine &engine : c_engines)
+    {
+        if (engine.engine != Regex::Engine::Dfa)
+        {
+            checkSearch(report, engine, pattern, strings);
+        }
+    }
+}
+
+} // namespace fsmtest
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+namespace fsmtest {
+
+/// Counts the checks of a test and prints the first few that fail.
+class Report final
+{
+public: // methods
+    explicit Report(const std::string &name)
+        : m_name{name}
+        , m_checks{0}
+        , m_failures{0}
+    {
+    }
+
+    /// @p describe returns the case that failed; it is only called then.
+    template <class Describe>
+    void check(bool ok, Describe describe)
+    {
+        m_checks++;
+
+        if (!ok && m_failures++ < c_max_printed)
+        {
+            std::cerr << m_name << ": " << describe() << std::endl;
+        }
+    }
+
+    std::size_t getChecks() const
+    {
+        return m_checks;
+    }
+
+    std::size_t getFailures() const
+    {
+        return m_failures;
+    }
+
+private: // constants
+    static constexpr std::size_t c_max_printed = 10;
+
+private: // fields
+    std::string m_name;
+    std::size_t m_checks;
+    std::size_t m_failures;
+};
+
+} // namespace fsmtest
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Report.hpp"
+
+namespace fsmtest {
+
+/// rev(), det() and min() against the automaton they were built from.
+void testAutomata(Report &report);
+
+/// det() on large automata and on several threads, and against itself on
+/// deterministic ones.
+void testDeterminization(Report &report);
+
+/// Hopcroft's and Brzozowski's minimization against each other.
+void testMinimization(Report &report);
+
+/// det() and min() on automata with epsilon cycles.
+void testClosures(Report &report);
+
+/// Every engine and construction against std::regex.
+void testMatching(Report &report);
+
+/// LazyDfa with a cache too small to hold every state it meets.
+void testLazyDfa(Report &report);
+
+/// Nfa with and without bit-parallel simulation.
+void testNfa(Report &report);
+
+/// The ids that RegexSet::match() reports against std::regex on each
+/// pattern.
+void testRegexSet(Report &report);
+
+/// Regex::stream() against std::regex on every prefix.
+void testStream(Report &report);
+
+/// Dfa::runParallel() against Dfa::run().
+void testParallel(Report &report);
+
+/// Fsm::getByteClasses(), and matching on bytes that the pattern does not
+/// mention.
+void testByteClasses(Report &report);
+
+/// Intersection, difference and complement.
+void testProducts(Report &report);
+
+/// Equivalence and inclusion, with their counterexamples.
+void testEquivalence(Report &report);
+
+/// Concatenation, disjunction, option and iteration, copying their operands
+/// or not.
+void testCombinators(Report &report);
+
+/// Regex on patterns that are deeply nested or very long.
+void testDeepPatterns(Report &report);
+
+/// Regex on patterns that the AST optimizer rewrites.
+void testOptimizer(Report &report);
+
+/// Regex::requiredLiteral() on the strings that match, and LiteralFinder
+/// against std::string::find().
+void testPrefilter(Report &report);
+
+/// Regex::find() and Regex::findAll() against std::regex on every substring.
+void testSearch(Report &report);
+
+/// Regex::capture() against the groups of std::regex.
+void testCaptures(Report &report);
+
+} // namespace fsmtest
@@ -0,0 +1,81 @@
+#include <cstring>
+#include <iostream>
+#include "Report.hpp"
+#include "Tests.hpp"
+
+namespace {
+
+struct Test
+{
+    const char *name;
+    void (*run)(fsmtest::Report &);
+};
+
+const Test c_tests[] = {
+    {"automata", fsmtest::testAutomata},
+    {"det", fsmtest::testDeterminization},
+    {"min", fsmtest::testMinimization},
+    {"closures", fsmtest::testClosures},
+    {"products", fsmtest::testProducts},
+    {"equivalence", fsmtest::testEquivalence},
+    {"combinators", fsmtest::testCombinators},
+    {"matching", fsmtest::testMatching},
+    {"lazy", fsmtest::testLazyDfa},
+    {"nfa", fsmtest::testNfa},
+    {"regexset", fsmtest::testRegexSet},
+    {"stream", fsmtest::testStream},
+    {"parallel", fsmtest::testParallel},
+    {"classes", fsmtest::testByteClasses},
+    {"deep", fsmtest::testDeepPatterns},
+    {"optimizer", fsmtest::testOptimizer},
+    {"prefilter", fsmtest::testPrefilter},
+    {"search", fsmtest::testSearch},
+    {"captures", fsmtest::testCaptures},
+};
+
+bool isSelected(int argc, char **argv, const Test &test)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (!std::strcmp(argv[i], test.name))
+        {
+            return true;
+        }
+    }
+
+    return argc < 2;
+}
+
+} // namespace
+
+/// Runs the tests named on the command line, or all of them.
+int main(int argc, char **argv)
+{
+    int selected = 0;
+    bool failed = false;
+
+    for (const Test &test : c_tests)
+    {
+        if (!isSelected(argc, argv, test))
+        {
+            continue;
+        }
+
+        fsmtest::Report report(test.name);
+        test.run(report);
+
+        std::cout << test.name << ": " << report.getChecks() << " checks, "
+                  << report.getFailures() << " failures" << std::endl;
+
+        selected++;
+        failed = failed || report.getFailures() > 0;
+    }
+
+    if (selected < argc - 1)
+    {
+        std::cerr << "usage: fsm_random_test [test...]" << std::endl;
+        return 1;
+    }
+
+    return failed ? 1 : 0;
+}
@@ -233,6 +233,18 @@ void Controller::setupCommands()
     m_processor.registerCommand("rev", [&]() { loadFsm(buildFsm().rev()); });
     m_processor.registerCommand("det", [&]() { loadFsm(buildFsm().det()); });
     m_processor.registerCommand("min", [&]() { loadFsm(buildFsm().min()); });
+    m_processor.registerCommand("min", [&](const std::string &algorithm) {
+        minimize(algorithm);
+    });
+
+    m_processor.registerCommand(
+        "compl", [&]() { loadFsm(fsm::Fsm::complement(buildFsm())); });
+    m_processor.registerCommand("inter", [&](const std::string &pattern) {
+        combine(pattern, fsm::Fsm::intersection);
+    });
+    m_processor.registerCommand("diff", [&](const std::string &pattern) {
+        combine(pattern, fsm::Fsm::difference);
+    });
 
     m_processor.registerCommand("export", [&]() { exportGraphviz(); });
     m_processor.registerCommand("export", [&](const std::string &file_name) {
@@ -484,6 +496,48 @@ void Controller::printFsm(const fsm::Fsm &fsm)
     print(stream.str());
 }
 
+void Controller::minimize(const std::string &algorithm)
+{
+    fsm::Fsm::Minimization minimization;
+
+    if (algorithm == "brzozowski")
+    {
+        minimization = fsm::Fsm::Minimization::Brzozowski;
+    }
+    else if (algorithm == "hopcroft")
+    {
+        minimization = fsm::Fsm::Minimization::Hopcroft;
+    }
+    else if (algorithm == "auto")
+    {
+        minimization = fsm::Fsm::Minimization::Auto;
+    }
+    else
+    {
+        print("error: invalid minimization algorithm");
+        return;
+    }
+
+    loadFsm(buildFsm().min(minimization));
+}
+
+/// Replaces the automaton with the result of the operation applied to it and
+/// the automaton of the pattern.
+void Controller::combine(
+    const std::string &pattern,
+    fsm::Fsm (*operation)(const fsm::Fsm &, const fsm::Fsm &))
+{
+    try
+    {
+        fsm::Fsm other = fsm::Regex::buildFsm(pattern);
+        loadFsm(operation(buildFsm(), other));
+    }
+    catch (const std::exception &e)
+    {
+        print("error: " + std::string(e.what()));
+    }
+}
+
 fsm::Fsm Controller::buildFsm()
 {
     fsm::Fsm fsm(m_states.size());
@@ -508,10 +562,14 @@ fsm::Fsm Controller::buildFsm()
 
     for (TransitionGraphicsObjectPtr t : m_transitions)
     {
-        fsm.connect(
-            state_indices[t->getStart()],
-            state_indices[t->getEnd()],
-            t->getSymbol());
+        for (const TransitionGraphicsObject::Range &range : t->getRanges())
+        {
+            fsm.connect(
+                state_indices[t->getStart()],
+                state_indices[t->getEnd()],
+                range.first,
+                range.second);
+        }
     }
 
     return fsm;
@@ -521,9 +579,9 @@ void Controller::loadFsm(const fsm::Fsm &fsm)
 {
     reset();
 
-    auto transitions = fsm.getTransitions();
-    auto starting_states = fsm.getStartingStates();
-    auto final_states = fsm.getFinalStates();
+    const auto &transitions = fsm.getTransitions();
+    const auto &starting_states = fsm.getStartingStates();
+    const auto &final_states = fsm.getFinalStates();
 
     auto pos = []() {
         return QVector2D(
@@ -549,24 +607,36 @@ void Controller::loadFsm(const fsm::Fsm &fsm)
         }
     }
 
+    // The transitions between two states on symbols are drawn as one edge
+    // with all of their ranges, and epsilon transitions as another.
     for (fsm::Fsm::state_t s1 = 0; s1 < transitions.size(); s1++)
     {
-        for (fsm::Fsm::state_t s2 = 0; s2 < transitions.size(); s2++)
+        using Edge = std::pair<fsm::Fsm::state_t, bool>;
+        std::map<Edge, TransitionGraphicsObjectPtr> edges;
+
+        for (const fsm::Fsm::Transition &tr : transitions[s1])
         {
-            for (fsm::Fsm::symbol_t a : transitions[s1][s2])
+            fsm::Fsm::state_t s2 = tr.state;
+
+            TransitionGraphicsObjectPtr &transition =
+                edges[Edge(s2, tr.isEpsilon())];
+
+            if (transition)
             {
-                TransitionGraphicsObjectPtr transition{
-                    new TransitionGraphicsObject(m_states[s1], pos())};
+                transition->addSymbols(tr.first, tr.last);
+                continue;
+            }
 
-                transition->setEnd(m_states[s2]);
-                transition->setSymbol(a);
+            transition.reset(new TransitionGraphicsObject(m_states[s1], pos()));
 
-                m_states[s1]->connect(transition);
-                m_states[s2]->connect(transition);
+            transition->setEnd(m_states[s2]);
+            transition->setSymbols(tr.first, tr.last);
 
-                m_objects.emplace_back(transition);
-                m_transitions.emplace_back(transition);
-            }
+            m_states[s1]->connect(transition);
+            m_states[s2]->connect(transition);
+
+            m_objects.emplace_back(transition);
+            m_transitions.emplace_back(transition);
         }
     }
 
@@ -583,7 +653,6 @@ void Controller::exportGraphviz()
     }
 }
 
-///@todo Fix exporting for transition on characters that need to be escaped
 void Controller::exportGraphviz(const std::string &file_name)
 {
     if (file_name.empty())
@@ -622,10 +691,21 @@ void Controller::exportGraphviz(const std::string &file_name)
 
     for (TransitionGraphicsObjectPtr t : m_transitions)
     {
-        char sym[] = {t->getSymbol(), '\0'};
+        std::string label;
+
+        for (char c : t->getLabel())
+        {
+            if (c == '"' || c == '\\')
+            {
+                label += '\\';
+            }
+
+            label += c;
+        }
+
         file << "\"" << state_indices[t->getStart()] << "\"->\""
-             << state_indices[t->getEnd()] << "\"[label=\""
-             << (sym[0] ? sym : "\u03b5") << "\"];" << std::endl;
+             << state_indices[t->getEnd()] << "\"[label=\"" << label
+             << "\"];" << std::endl;
     }
 
     file << "}" << std::endl;
@@ -726,7 +806,19 @@ void Controller::save(const std::string &file_name)
 
     std::memcpy(header.magic_number, "FSM", 3);
     header.states = m_states.size();
-    header.transitions = m_transitions.size();
+    // A record holds a single symbol, so an edge is saved as one record per
+    // symbol, and open() joins them back together.
+    header.transitions = 0;
+
+    for (TransitionGraphicsObjectPtr t : m_transitions)
+    {
+        for (const TransitionGraphicsObject::Range &range : t->getRanges())
+        {
+            header.transitions += static_cast<unsigned char>(range.second) -
+                                  static_cast<unsigned char>(range.first) + 1;
+        }
+    }
+
     header.x_offset = translation.x();
     header.y_offset = translation.y();
     header.scale = scale;
@@ -757,11 +849,19 @@ void Controller::save(const std::string &file_name)
 
         rec.start = state_indices[t->getStart()];
         rec.end = state_indices[t->getEnd()];
-        rec.symbol = t->getSymbol();
         rec.x = t->getPos().x();
         rec.y = t->getPos().y();
 
-        write(file, rec);
+        for (const TransitionGraphicsObject::Range &range : t->getRanges())
+        {
+            for (unsigned a = static_cast<unsigned char>(range.first);
+                 a <= static_cast<unsigned char>(range.second);
+                 a++)
+            {
+                rec.symbol = static_cast<char>(a);
+                write(file, rec);
+            }
+        }
     }
 }
 
@@ -813,17 +913,33 @@ void Controller::open(const std::string &file_name)
             QVector2D(rec.x, rec.y), rec.is_starting, rec.is_final, false);
     }
 
+    TransitionGraphicsObjectPtr transition;
+    TransitionRecord previous{};
+
     for (std::size_t i = 0; i < header.transitions; i++)
     {
         TransitionRecord rec;
         read(file, rec);
 
-        createTransition(
-            m_states[rec.start],
-            m_states[rec.end],
-            rec.symbol,
-            QVector2D(rec.x, rec.y),
-            false);
+        // Consecutive records on symbols of the same edge come from one
+        // edge with several symbols.
+        if (transition && rec.symbol && previous.symbol &&
+            rec.start == previous.start && rec.end == previous.end &&
+            rec.x == previous.x && rec.y == previous.y)
+        {
+            transition->addSymbols(rec.symbol, rec.symbol);
+        }
+        else
+        {
+            transition = createTransition(
+                m_states[rec.start],
+                m_states[rec.end],
+                rec.symbol,
+                QVector2D(rec.x, rec.y),
+                false);
+        }
+
+        previous = rec;
     }
 
     updateConnectedComponents();
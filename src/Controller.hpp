@@ -80,6 +80,10 @@ private: // methods
     void setDefaultSymbol(const std::string &sym);
 
     void printFsm(const fsm::Fsm &fsm);
+    void minimize(const std::string &algorithm);
+    void combine(
+        const std::string &pattern,
+        fsm::Fsm (*operation)(const fsm::Fsm &, const fsm::Fsm &));
     fsm::Fsm buildFsm();
     void loadFsm(const fsm::Fsm &fsm);
 
@@ -1,16 +1,53 @@
 #include "TransitionGraphicsObject.hpp"
+#include <bitset>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <QtGui/QtGui>
 
 namespace fsmviz {
 
+namespace {
+
+/// Symbol as it is written in a bracket expression.
+std::string escape(unsigned char c)
+{
+    switch (c)
+    {
+    case '\n':
+        return "\\n";
+
+    case '\r':
+        return "\\r";
+
+    case '\t':
+        return "\\t";
+    }
+
+    if (c < 0x20 || c >= 0x7f)
+    {
+        char hex[5];
+        std::snprintf(hex, sizeof(hex), "\\x%02x", c);
+        return hex;
+    }
+
+    if (std::strchr("[]\\^-", c))
+    {
+        return std::string{'\\', static_cast<char>(c)};
+    }
+
+    return std::string(1, static_cast<char>(c));
+}
+
+} // namespace
+
 TransitionGraphicsObject::TransitionGraphicsObject(
     StateGraphicsObjectPtr start,
     const QVector2D &pos)
     : GraphicsObject{pos}
     , m_start{start}
     , m_end{nullptr}
-    , m_symbol{'\0'}
+    , m_ranges{Range('\0', '\0')}
     , m_editing{false}
 {
 }
@@ -111,17 +148,12 @@ void TransitionGraphicsObject::render(QPainter &p, int pass)
         {
             p.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
 
-            static constexpr int c_rect_size = 15;
-
-            QPoint center = QPoint(c_rect_size, c_rect_size) / 2;
-            QSize size(c_rect_size, c_rect_size);
+            const QString label = QString::fromStdString(getLabel());
 
-            const char sym[] = {m_symbol, '\0'};
+            QRect rect = p.fontMetrics().boundingRect(label);
+            rect.moveCenter(m_pos.toPoint());
 
-            p.drawText(
-                QRect(m_pos.toPoint() - center, size),
-                Qt::AlignCenter,
-                QString(sym[0] ? sym : "\u03b5"));
+            p.drawText(rect, Qt::AlignCenter | Qt::TextDontClip, label);
         }
     }
 } // namespace fsmviz
@@ -139,10 +171,29 @@ void TransitionGraphicsObject::setEnd(StateGraphicsObjectPtr end)
 
 void TransitionGraphicsObject::setSymbol(char symbol)
 {
-    m_symbol = symbol;
+    setSymbols(symbol, symbol);
+}
+
+void TransitionGraphicsObject::setSymbols(char first, char last)
+{
+    m_ranges.assign(1, Range(first, last));
     m_editing = false;
 }
 
+/// A range that continues the last one is merged into it.
+void TransitionGraphicsObject::addSymbols(char first, char last)
+{
+    if (!m_ranges.empty() &&
+        static_cast<unsigned char>(m_ranges.back().second) + 1 ==
+            static_cast<unsigned char>(first))
+    {
+        m_ranges.back().second = last;
+        return;
+    }
+
+    m_ranges.emplace_back(first, last);
+}
+
 StateGraphicsObjectPtr TransitionGraphicsObject::getStart() const
 {
     return m_start;
@@ -153,9 +204,94 @@ StateGraphicsObjectPtr TransitionGraphicsObject::getEnd() const
     return m_end;
 }
 
-char TransitionGraphicsObject::getSymbol() const
+const std::vector<TransitionGraphicsObject::Range> &TransitionGraphicsObject::
+    getRanges() const
+{
+    return m_ranges;
+}
+
+std::string TransitionGraphicsObject::getLabel() const
 {
-    return m_symbol;
+    std::bitset<256> symbols;
+
+    for (const Range &range : m_ranges)
+    {
+        for (unsigned c = static_cast<unsigned char>(range.first);
+             c <= static_cast<unsigned char>(range.second);
+             c++)
+        {
+            symbols.set(c);
+        }
+    }
+
+    symbols.reset(0);
+
+    if (symbols.none())
+    {
+        return "\u03b5";
+    }
+
+    if (symbols.count() == 1)
+    {
+        for (unsigned c = 1; c < symbols.size(); c++)
+        {
+            if (symbols[c] && c >= 0x20 && c < 0x7f)
+            {
+                return std::string(1, static_cast<char>(c));
+            }
+
+            if (symbols[c])
+            {
+                return escape(c);
+            }
+        }
+    }
+
+    if (symbols.count() == symbols.size() - 1)
+    {
+        return ".";
+    }
+
+    const bool negated = 2 * symbols.count() > symbols.size();
+
+    if (negated)
+    {
+        symbols.flip();
+        symbols.reset(0);
+    }
+
+    std::string label = negated ? "[^" : "[";
+
+    for (unsigned c = 1; c < symbols.size(); c++)
+    {
+        if (!symbols[c])
+        {
+            continue;
+        }
+
+        unsigned last = c;
+
+        while (last + 1 < symbols.size() && symbols[last + 1])
+        {
+            last++;
+        }
+
+        label += escape(c);
+
+        if (last > c + 1)
+        {
+            label += '-';
+        }
+
+        if (last > c)
+        {
+            label += escape(last);
+        }
+
+        c = last;
+    }
+
+    return label + "]";
 }
 
 void TransitionGraphicsObject::startEditing()
@@ -1,11 +1,19 @@
 #pragma once
 
+#include <string>
+#include <utility>
+#include <vector>
 #include "StateGraphicsObject.hpp"
 
 namespace fsmviz {
 
+/// Edge between two states on one or more ranges of symbols. The symbol
+/// '\0' is epsilon.
 class TransitionGraphicsObject : public GraphicsObject
 {
+public: // types
+    using Range = std::pair<char, char>;
+
 public: // methods
     explicit TransitionGraphicsObject(
         StateGraphicsObjectPtr start,
@@ -17,10 +25,16 @@ public: // methods
 
     void setEnd(StateGraphicsObjectPtr end);
     void setSymbol(char symbol);
+    void setSymbols(char first, char last);
+    void addSymbols(char first, char last);
 
     StateGraphicsObjectPtr getStart() const;
     StateGraphicsObjectPtr getEnd() const;
-    char getSymbol() const;
+    const std::vector<Range> &getRanges() const;
+
+    /// The symbol of the edge, or a bracket expression for several symbols,
+    /// negated if most bytes are in it.
+    std::string getLabel() const;
 
     void startEditing();
     void finishEditing();
@@ -31,7 +45,7 @@ private: // methods
 private: // fields
     StateGraphicsObjectPtr m_start;
     StateGraphicsObjectPtr m_end;
-    char m_symbol;
+    std::vector<Range> m_ranges;
     bool m_editing;
 };
 